@@ -31,7 +31,7 @@ namespace CptBlackBill {
                 eosio_assert(locationIsValid, "Location (latitude and/ord longitude) is not valid.");
                 challengeIndex challenges(_self, _self);
                 
-                challenges.emplace(account, [&](auto& challenge) {
+                auto newchallenge = challenges.emplace(account, [&](auto& challenge) {
                     challenge.pkey = challenges.available_primary_key();
                     challenge.editorsAccount = name{editorsAccount}; //Usually the same as the account that pays for storage, but can be another account if you want to give update access to another account
                     challenge.storagePayerAccount = name{account}; //The account that pays for RAM storage
@@ -44,6 +44,8 @@ namespace CptBlackBill {
                     challenge.timestamp = now();
                     //print("NewChallengePkey: ", challenge.pkey); 
                 });
+
+                addKeywords(account, newchallenge->pkey, title);
             }
 
             //@abi action
@@ -63,6 +65,8 @@ namespace CptBlackBill {
                 eosio_assert(videoUrl.length() <= 100, "Max length of video url is 100 characters.");
                 eosio_assert(category.length() <= 50, "Max length of category is 50 characters.");
 
+                bool keywordsChanged = (title != iterator->title || category != iterator->category);
+
                 challenges.modify(iterator, account, [&](auto& challenge) {
                     eosio_assert(account == challenge.storagePayerAccount, "Account is not allowed to update this Challenge.");
                     challenge.title = title;
@@ -73,6 +77,11 @@ namespace CptBlackBill {
                     challenge.level = level;
                     //print("UpdateTitleOk");
                 });
+
+                if(keywordsChanged) {
+                    eraseKeywords(pkey);
+                    addKeywords(account, pkey, title + " " + category);
+                }
             }
 
             //@abi action
@@ -113,10 +122,25 @@ namespace CptBlackBill {
                 eosio_assert(account == challenges.get(pkey).storagePayerAccount, "Account is not allowed to remove this Challenge.");
   
                 challenges.erase(iterator); 
+                eraseKeywords(pkey);
 
                 //print("RemoveChallengeOK"); 
             }
 
+            //@abi action
+            void reindexkw(uint64_t frompkey, uint64_t topkey) {
+
+                require_auth(_self); //Rebuilds the keyword rows of challenges created before the keywords table existed
+
+                eosio_assert(frompkey < topkey, "frompkey must be lower than topkey.");
+
+                challengeIndex challenges(_self, _self);
+                for(auto iterator = challenges.lower_bound(frompkey); iterator != challenges.end() && iterator->pkey < topkey; ++iterator) {
+                    eraseKeywords(iterator->pkey);
+                    addKeywords(_self, iterator->pkey, iterator->title + " " + iterator->category);
+                }
+            }
+
         private:
             //@abi table challenges i64
             struct challenge {
@@ -147,11 +171,93 @@ namespace CptBlackBill {
 
             typedef multi_index<N(challenges), challenge> challengeIndex;
 
+            //@abi table keywords i64
+            struct keyword {
+                uint64_t pkey;
+                uint64_t keyhash; //Hash of one normalized word in the title or category (see keywordHash)
+                uint64_t challengepkey;
+
+                uint64_t primary_key() const { return  pkey; }
+                uint64_t by_keyhash() const { return keyhash; }
+                uint64_t by_challenge() const { return challengepkey; }
+
+                EOSLIB_SERIALIZE(keyword, (pkey)(keyhash)(challengepkey))
+            };
+
+            typedef multi_index<N(keywords), keyword,
+                    indexed_by< N(keyhash), const_mem_fun<keyword, uint64_t, &keyword::by_keyhash>>,
+                    indexed_by< N(challenge), const_mem_fun<keyword, uint64_t, &keyword::by_challenge>>
+                > keywordIndex;
+
+            //Same normalization and 64-bit FNV-1a hash as the keywords table in the cptblackbill contract, 
+            //so clients can search treasures and challenges with one set of word hashes. Only A-Z are lower-cased, 
+            //non-ASCII characters are hashed as their UTF-8 bytes. At most keywordMaxWords words are indexed 
+            //per challenge since the account that adds it pays for the rows.
+            static const size_t keywordMaxWords = 5;
+
+            static uint64_t keywordHash(const string& word) {
+                uint64_t hash = 14695981039346656037ULL;
+                for(char c : word) {
+                    hash ^= (uint8_t)c;
+                    hash *= 1099511628211ULL;
+                }
+                return hash;
+            }
+
+            static vector<uint64_t> getKeywordHashes(const string& text) {
+                vector<uint64_t> hashes;
+                string word;
+                for(size_t i = 0; i <= text.length(); ++i) {
+                    char c = (i < text.length()) ? text[i] : ' ';
+                    if(c >= 'A' && c <= 'Z')
+                        c += 'a' - 'A';
+
+                    if((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (uint8_t)c >= 0x80) {
+                        word += c;
+                        continue;
+                    }
+
+                    if(word.length() >= 2) {
+                        uint64_t hash = keywordHash(word);
+                        bool duplicate = false;
+                        for(uint64_t h : hashes) {
+                            if(h == hash) duplicate = true;
+                        }
+                        if(!duplicate)
+                            hashes.push_back(hash);
+                        if(hashes.size() >= keywordMaxWords)
+                            break;
+                    }
+                    word.clear();
+                }
+                return hashes;
+            }
+
+            void addKeywords(const account_name payer, uint64_t challengepkey, const string& text) {
+                keywordIndex keywords(_self, _self);
+                for(uint64_t hash : getKeywordHashes(text)) {
+                    keywords.emplace(payer, [&](auto& keyword) {
+                        keyword.pkey = keywords.available_primary_key();
+                        keyword.keyhash = hash;
+                        keyword.challengepkey = challengepkey;
+                    });
+                }
+            }
+
+            void eraseKeywords(uint64_t challengepkey) {
+                keywordIndex keywords(_self, _self);
+                auto bychallenge = keywords.get_index<N(challenge)>();
+                auto iterator = bychallenge.lower_bound(challengepkey);
+                while(iterator != bychallenge.end() && iterator->challengepkey == challengepkey) {
+                    iterator = bychallenge.erase(iterator);
+                }
+            }
+
             /*typedef multi_index<N(challenges), challenge,
                     indexed_by< N(latitude), const_mem_fun<challenge, double, &challenge::by_latitude>>,
                     indexed_by< N(videoviewcount), const_mem_fun<challenge, uint64_t, &challenge::by_videoviews>>
                 > challengeIndex;*/
     };
 
-    EOSIO_ABI(Challenge, (add)(update)(updtcrf)(remove))
+    EOSIO_ABI(Challenge, (add)(update)(updtcrf)(remove)(reindexkw))
 }
\ No newline at end of file
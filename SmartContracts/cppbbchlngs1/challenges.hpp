@@ -4,5 +4,4 @@
  */
 #include <eosiolib/eosio.hpp>
 #include <eosiolib/asset.hpp>
-#include <eosiolib/print.hpp>
 #include <string>
\ No newline at end of file
@@ -118,16 +118,24 @@ public:
             auto iterator = treasures.find(treasurepkey);
             eosio_assert(iterator != treasures.end(), "Treasure not found.");
 
-            //Add row to verifycheck
+            //Add row to verifycheck. A pending check by this account on the same treasure is replaced by a row with a 
+            //new pkey, so a worker that already read the old row and erases it by pkey does not remove this one.
             verifycheck_index verifycheck(_self, _self.value);
+            uint64_t checkpkey = verifycheck.available_primary_key();
+            auto bytreasureaccount = verifycheck.get_index<"traccount"_n>();
+            auto pendingcheck = bytreasureaccount.find(get_treasure_account_key(treasurepkey, from));
+            if(pendingcheck != bytreasureaccount.end())
+                bytreasureaccount.erase(pendingcheck);
+
             verifycheck.emplace(_self, [&]( auto& row ) {
-                row.pkey = verifycheck.available_primary_key();
+                row.pkey = checkpkey;
                 row.treasurepkey = treasurepkey;
                 row.byaccount = from;
                 row.timestamp = now();
             });
 
             //Tag the transfered amount on the treasure so the modtrchest-function can store the treasure value as an encrypted(hidden value)
+            uint64_t oldrankingpoint = iterator->rankingpoint;
             treasures.modify(iterator, _self, [&]( auto& row ) {
                 row.prechesttransfer += eos;
 
@@ -136,6 +144,9 @@ public:
                     row.rankingpoint = 1;
                 } 
             });
+
+            if(iterator->rankingpoint != oldrankingpoint)
+                update_geotiles_ranking(treasurepkey, iterator->latitude, iterator->longitude, iterator->rankingpoint);
         }
         if (memo.rfind("Unlock Treasure No.", 0) == 0) {
             //from account pays to unlock a treasure
@@ -148,10 +159,19 @@ public:
             uint64_t treasurepkey = std::strtoull( memo.substr(0, delimiterlocation).c_str(),NULL,0 ); 
             std::string secretcode = memo.substr(delimiterlocation + 1);
 
-            //Add row to verifyunlock
+            //Add row to verifyunlock. A retry by the same account on the same treasure replaces the pending attempt
+            //so the queue does not grow when an account keeps trying secret codes. The new attempt gets a new pkey 
+            //(taken before the old row is erased), so eraseverunlc on the old pkey by a worker that already read the 
+            //old attempt does not drop the new secret code.
             verifyunlock_index verifyunlock(_self, _self.value);
+            uint64_t unlockpkey = verifyunlock.available_primary_key();
+            auto bytreasureaccount = verifyunlock.get_index<"traccount"_n>();
+            auto pendingunlock = bytreasureaccount.find(get_treasure_account_key(treasurepkey, from));
+            if(pendingunlock != bytreasureaccount.end())
+                bytreasureaccount.erase(pendingunlock);
+
             verifyunlock.emplace(_self, [&]( auto& row ) {
-                row.pkey = verifyunlock.available_primary_key();
+                row.pkey = unlockpkey;
                 row.treasurepkey = treasurepkey;
                 row.secretcode = secretcode;
                 row.byaccount = from;
@@ -191,7 +211,7 @@ public:
         
         treasure_index treasures(_code, _code.value);
         
-        treasures.emplace(owner, [&]( auto& row ) {
+        auto newtreasure = treasures.emplace(owner, [&]( auto& row ) {
             row.pkey = treasures.available_primary_key();
             row.owner = owner;
             row.title = title;
@@ -199,9 +219,13 @@ public:
             row.latitude = latitude;
             row.longitude = longitude;
             row.prechesttransfer = eosio::asset(0, symbol(symbol_code("EOS"), 4));
+            row.rankingpoint = 0; //Not activated until the owner pays to check the treasure value
             row.expirationdate = now() + 94608000; //Treasure expires after three years if not found
             row.timestamp = now();
         });
+
+        add_keywords(owner, newtreasure->pkey, title);
+        add_to_geotiles(owner, newtreasure->pkey, latitude, longitude, 0);
     }
 
     [[eosio::action]]
@@ -219,12 +243,19 @@ public:
         eosio_assert(imageurl.length() <= 100, "Max length of image url is 100 characters.");
         eosio_assert(videourl.length() <= 100, "Max length of video url is 100 characters.");
         
+        bool titlechanged = (title != iterator->title);
+
         treasures.modify(iterator, user, [&]( auto& row ) {
             row.title = title;
             row.description = description;
             row.imageurl = imageurl;
             row.videourl = videourl;
         });
+
+        if(titlechanged) {
+            erase_keywords(pkey);
+            add_keywords(user, pkey, title);
+        }
     }
 
 /*
@@ -365,7 +396,38 @@ public:
         auto iterator = treasures.find(pkey);
         eosio_assert(iterator != treasures.end(), "Treasure does not exist.");
         eosio_assert(user == iterator->owner || user == "cptblackbill"_n, "You don't have access to remove this treasure.");
+        double latitude = iterator->latitude;
+        double longitude = iterator->longitude;
         treasures.erase(iterator);
+        erase_keywords(pkey);
+        remove_from_geotiles(pkey, latitude, longitude);
+    }
+
+    //Rebuild the keyword rows of the treasures with pkey in [frompkey, topkey). Used to index treasures created before 
+    //the keywords table existed. Run it over small pkey ranges so each transaction stays within the CPU limit.
+    [[eosio::action]]
+    void reindexkw(uint64_t frompkey, uint64_t topkey) {
+        require_auth("cptblackbill"_n);
+        eosio_assert(frompkey < topkey, "frompkey must be lower than topkey.");
+
+        treasure_index treasures(_code, _code.value);
+        for(auto iterator = treasures.lower_bound(frompkey); iterator != treasures.end() && iterator->pkey < topkey; ++iterator) {
+            erase_keywords(iterator->pkey);
+            add_keywords(_self, iterator->pkey, iterator->title);
+        }
+    }
+
+    //Count the treasures with pkey in [frompkey, topkey) that are not in the geotiles yet. Used for treasures created 
+    //before the geotiles table existed. Run it over small pkey ranges so each transaction stays within the CPU limit.
+    [[eosio::action]]
+    void backfillgeo(uint64_t frompkey, uint64_t topkey) {
+        require_auth("cptblackbill"_n);
+        eosio_assert(frompkey < topkey, "frompkey must be lower than topkey.");
+
+        treasure_index treasures(_code, _code.value);
+        for(auto iterator = treasures.lower_bound(frompkey); iterator != treasures.end() && iterator->pkey < topkey; ++iterator) {
+            add_to_geotiles(_self, iterator->pkey, iterator->latitude, iterator->longitude, iterator->rankingpoint); //Owners have not authorized this action, so the contract pays
+        }
     }
 
     [[eosio::action]]
@@ -523,6 +585,11 @@ private:
             eosio::indexed_by<"owner"_n, const_mem_fun<treasure, uint64_t, &treasure::by_owner>>,
             eosio::indexed_by<"rankingpoint"_n, const_mem_fun<treasure, uint64_t, &treasure::by_rankingpoint>>> treasure_index;
 
+    //Secondary key for looking up the pending row of one account on one treasure
+    static uint128_t get_treasure_account_key(uint64_t treasurepkey, name account) {
+        return ((uint128_t)treasurepkey << 64) | account.value;
+    }
+
     struct [[eosio::table]] verifycheck {
         uint64_t pkey;
         uint64_t treasurepkey;
@@ -530,8 +597,12 @@ private:
         int32_t timestamp;
 
         uint64_t primary_key() const { return  pkey; }
+        uint64_t by_treasurepkey() const {return treasurepkey; } //second key, can be non-unique
+        uint128_t by_treasureaccount() const {return get_treasure_account_key(treasurepkey, byaccount); } //third key, unique
     };
-    typedef eosio::multi_index<"verifycheck"_n, verifycheck> verifycheck_index;
+    typedef eosio::multi_index<"verifycheck"_n, verifycheck, 
+            eosio::indexed_by<"treasurepkey"_n, const_mem_fun<verifycheck, uint64_t, &verifycheck::by_treasurepkey>>, 
+            eosio::indexed_by<"traccount"_n, const_mem_fun<verifycheck, uint128_t, &verifycheck::by_treasureaccount>>> verifycheck_index;
 
     struct [[eosio::table]] verifyunlock {
         uint64_t pkey;
@@ -544,8 +615,12 @@ private:
         int32_t timestamp;
 
         uint64_t primary_key() const { return  pkey; }
+        uint64_t by_treasurepkey() const {return treasurepkey; } //second key, can be non-unique
+        uint128_t by_treasureaccount() const {return get_treasure_account_key(treasurepkey, byaccount); } //third key, unique
     };
-    typedef eosio::multi_index<"verifyunlock"_n, verifyunlock> verifyunlock_index;
+    typedef eosio::multi_index<"verifyunlock"_n, verifyunlock, 
+            eosio::indexed_by<"treasurepkey"_n, const_mem_fun<verifyunlock, uint64_t, &verifyunlock::by_treasurepkey>>, 
+            eosio::indexed_by<"traccount"_n, const_mem_fun<verifyunlock, uint128_t, &verifyunlock::by_treasureaccount>>> verifyunlock_index;
 
     struct [[eosio::table]] settings {
         eosio::name keyname; 
@@ -588,6 +663,54 @@ private:
     };
     typedef eosio::multi_index<"crewinfo"_n, crewinfo> crewinfo_index;
 
+    struct [[eosio::table]] keywords {
+        uint64_t pkey;
+        uint64_t keyhash; //Hash of one normalized word in the treasure title (see keyword_hash)
+        uint64_t treasurepkey;
+
+        uint64_t primary_key() const { return  pkey; }
+        uint64_t by_keyhash() const {return keyhash; } //second key, can be non-unique
+        uint64_t by_treasurepkey() const {return treasurepkey; } //third key, can be non-unique
+    };
+    typedef eosio::multi_index<"keywords"_n, keywords, 
+            eosio::indexed_by<"keyhash"_n, const_mem_fun<keywords, uint64_t, &keywords::by_keyhash>>, 
+            eosio::indexed_by<"treasurepkey"_n, const_mem_fun<keywords, uint64_t, &keywords::by_treasurepkey>>> keywords_index;
+
+    struct [[eosio::table]] geotiles {
+        uint64_t cellid; //Zoom level and quantized latitude/longitude (see geotile_cellid)
+        uint32_t treasurecount;
+        uint64_t maxrankingpoint;
+
+        uint64_t primary_key() const { return  cellid; }
+    };
+    typedef eosio::multi_index<"geotiles"_n, geotiles> geotiles_index;
+
+    //Number of treasures with one rankingpoint in one cell. The highest key below the next cell gives the cell maximum.
+    static uint128_t get_cell_rankingpoint_key(uint64_t cellid, uint64_t rankingpoint) {
+        return ((uint128_t)cellid << 64) | rankingpoint;
+    }
+
+    struct [[eosio::table]] geotilerank {
+        uint64_t pkey;
+        uint64_t cellid;
+        uint64_t rankingpoint;
+        uint32_t treasurecount;
+
+        uint64_t primary_key() const { return  pkey; }
+        uint128_t by_cellrankingpoint() const {return get_cell_rankingpoint_key(cellid, rankingpoint); } //second key, unique
+    };
+    typedef eosio::multi_index<"geotilerank"_n, geotilerank, 
+            eosio::indexed_by<"cellrank"_n, const_mem_fun<geotilerank, uint128_t, &geotilerank::by_cellrankingpoint>>> geotilerank_index;
+
+    //Treasures counted in the geotiles, with the rankingpoint they are counted with
+    struct [[eosio::table]] geotileitem {
+        uint64_t treasurepkey;
+        uint64_t rankingpoint;
+
+        uint64_t primary_key() const { return  treasurepkey; }
+    };
+    typedef eosio::multi_index<"geotileitem"_n, geotileitem> geotileitem_index;
+
     void send_summary(name user, std::string message) {
         action(
             permission_level{get_self(),"active"_n},
@@ -597,6 +720,242 @@ private:
         ).send();
     };
 
+    //---Keyword search index------------------------------------------------------------------------------
+    //Words are lower-cased (A-Z only), split on anything that is not a letter, digit or UTF-8 byte and hashed with 
+    //64-bit FNV-1a. Bytes of non-ASCII characters are kept as they are, without case-folding, so "Øya" and "øya" 
+    //are different words. Clients hash search words the same way, range-lookup each hash on the keyhash index and 
+    //intersect the treasurepkeys, instead of downloading the whole treasure table.
+    //Each word is a row with two secondary keys paid by the treasure owner, so only the first keyword_maxwords 
+    //distinct words are indexed. Accounts created by the relay have little RAM to spare.
+    static constexpr size_t keyword_maxwords = 5;
+
+    static uint64_t keyword_hash(const std::string& word) {
+        uint64_t hash = 14695981039346656037ULL;
+        for(char c : word) {
+            hash ^= (uint8_t)c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static std::vector<uint64_t> get_keyword_hashes(const std::string& text) {
+        std::vector<uint64_t> hashes;
+        std::string word;
+        for(size_t i = 0; i <= text.length(); ++i) {
+            char c = (i < text.length()) ? text[i] : ' ';
+            if(c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+
+            if((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (uint8_t)c >= 0x80) {
+                word += c;
+                continue;
+            }
+
+            if(word.length() >= 2) { //Single characters are too common to be useful search words
+                uint64_t hash = keyword_hash(word);
+                bool duplicate = false;
+                for(uint64_t h : hashes) {
+                    if(h == hash) duplicate = true;
+                }
+                if(!duplicate)
+                    hashes.push_back(hash);
+                if(hashes.size() >= keyword_maxwords)
+                    break;
+            }
+            word.clear();
+        }
+        return hashes;
+    }
+
+    void add_keywords(name payer, uint64_t treasurepkey, const std::string& title) {
+        keywords_index keywords(_self, _self.value);
+        for(uint64_t hash : get_keyword_hashes(title)) {
+            keywords.emplace(payer, [&]( auto& row ) {
+                row.pkey = keywords.available_primary_key();
+                row.keyhash = hash;
+                row.treasurepkey = treasurepkey;
+            });
+        }
+    }
+
+    void erase_keywords(uint64_t treasurepkey) {
+        keywords_index keywords(_self, _self.value);
+        auto bytreasure = keywords.get_index<"treasurepkey"_n>();
+        auto iterator = bytreasure.lower_bound(treasurepkey);
+        while(iterator != bytreasure.end() && iterator->treasurepkey == treasurepkey) {
+            iterator = bytreasure.erase(iterator);
+        }
+    }
+    //-----------------------------------------------------------------------------------------------------
+
+    //---Geo tiles for zoomed-out map views---------------------------------------------------------------
+    //Each zoom level splits the map in square cells. The cell id holds the zoom level in the top byte and 
+    //the quantized latitude/longitude cell numbers below, so one zoom level is one contiguous pkey range.
+    static constexpr uint8_t geotile_zoomlevels = 4;
+
+    static double geotile_cellsize(uint8_t zoom) {
+        switch(zoom) {
+            case 0:  return 20.0; //World
+            case 1:  return 5.0;  //Country
+            case 2:  return 1.0;  //Region
+            default: return 0.25; //County
+        }
+    }
+
+    static uint64_t geotile_cellid(uint8_t zoom, double latitude, double longitude) {
+        double cellsize = geotile_cellsize(zoom);
+        uint64_t latcell = (uint64_t)((latitude + 90) / cellsize);
+        uint64_t loncell = (uint64_t)((longitude + 180) / cellsize);
+        return ((uint64_t)zoom << 56) | (latcell << 28) | loncell;
+    }
+
+    //The geotileitem row belongs to one treasure and is paid by payer (the owner when adding a treasure). The cell 
+    //rows in geotiles and geotilerank are shared by many treasures and paid by the contract. There are at most 
+    //4 cells for each geotileitem row and one rank row per cell and rankingpoint, so the contract's RAM grows with 
+    //the number of occupied cells, not with the number of treasures.
+    void add_to_geotiles(name payer, uint64_t treasurepkey, double latitude, double longitude, uint64_t rankingpoint) {
+        geotileitem_index items(_self, _self.value);
+        if(items.find(treasurepkey) != items.end())
+            return; //Already counted
+
+        items.emplace(payer, [&]( auto& row ) {
+            row.treasurepkey = treasurepkey;
+            row.rankingpoint = rankingpoint;
+        });
+
+        geotiles_index geotiles(_self, _self.value);
+        for(uint8_t zoom = 0; zoom < geotile_zoomlevels; ++zoom) {
+            uint64_t cellid = geotile_cellid(zoom, latitude, longitude);
+            add_geotile_rankingpoint(cellid, rankingpoint);
+
+            auto iterator = geotiles.find(cellid);
+            if(iterator == geotiles.end()) {
+                geotiles.emplace(_self, [&]( auto& row ) {
+                    row.cellid = cellid;
+                    row.treasurecount = 1;
+                    row.maxrankingpoint = rankingpoint;
+                });
+            }
+            else {
+                geotiles.modify(iterator, _self, [&]( auto& row ) { //Moves cells first paid by a treasure owner to the contract
+                    row.treasurecount += 1;
+                    if(rankingpoint > row.maxrankingpoint)
+                        row.maxrankingpoint = rankingpoint;
+                });
+            }
+        }
+    }
+
+    void remove_from_geotiles(uint64_t treasurepkey, double latitude, double longitude) {
+        geotileitem_index items(_self, _self.value);
+        auto item = items.find(treasurepkey);
+        if(item == items.end())
+            return; //Never counted, see backfillgeo
+
+        uint64_t rankingpoint = item->rankingpoint;
+        items.erase(item);
+
+        geotiles_index geotiles(_self, _self.value);
+        for(uint8_t zoom = 0; zoom < geotile_zoomlevels; ++zoom) {
+            uint64_t cellid = geotile_cellid(zoom, latitude, longitude);
+            remove_geotile_rankingpoint(cellid, rankingpoint);
+
+            auto iterator = geotiles.find(cellid);
+            if(iterator == geotiles.end())
+                continue;
+
+            if(iterator->treasurecount <= 1) {
+                geotiles.erase(iterator);
+                continue;
+            }
+
+            uint64_t maxrankingpoint = get_geotile_maxrankingpoint(cellid);
+            geotiles.modify(iterator, same_payer, [&]( auto& row ) {
+                row.treasurecount -= 1;
+                row.maxrankingpoint = maxrankingpoint;
+            });
+        }
+    }
+
+    void update_geotiles_ranking(uint64_t treasurepkey, double latitude, double longitude, uint64_t newrankingpoint) {
+        geotileitem_index items(_self, _self.value);
+        auto item = items.find(treasurepkey);
+        if(item == items.end() || item->rankingpoint == newrankingpoint)
+            return;
+
+        uint64_t oldrankingpoint = item->rankingpoint;
+        items.modify(item, same_payer, [&]( auto& row ) {
+            row.rankingpoint = newrankingpoint;
+        });
+
+        geotiles_index geotiles(_self, _self.value);
+        for(uint8_t zoom = 0; zoom < geotile_zoomlevels; ++zoom) {
+            uint64_t cellid = geotile_cellid(zoom, latitude, longitude);
+            remove_geotile_rankingpoint(cellid, oldrankingpoint);
+            add_geotile_rankingpoint(cellid, newrankingpoint);
+
+            auto iterator = geotiles.find(cellid);
+            if(iterator == geotiles.end())
+                continue;
+
+            uint64_t maxrankingpoint = get_geotile_maxrankingpoint(cellid);
+            if(maxrankingpoint != iterator->maxrankingpoint) {
+                geotiles.modify(iterator, same_payer, [&]( auto& row ) {
+                    row.maxrankingpoint = maxrankingpoint;
+                });
+            }
+        }
+    }
+
+    void add_geotile_rankingpoint(uint64_t cellid, uint64_t rankingpoint) {
+        geotilerank_index ranks(_self, _self.value);
+        auto bycellrank = ranks.get_index<"cellrank"_n>();
+        auto iterator = bycellrank.find(get_cell_rankingpoint_key(cellid, rankingpoint));
+        if(iterator == bycellrank.end()) {
+            ranks.emplace(_self, [&]( auto& row ) {
+                row.pkey = ranks.available_primary_key();
+                row.cellid = cellid;
+                row.rankingpoint = rankingpoint;
+                row.treasurecount = 1;
+            });
+        }
+        else {
+            bycellrank.modify(iterator, same_payer, [&]( auto& row ) {
+                row.treasurecount += 1;
+            });
+        }
+    }
+
+    void remove_geotile_rankingpoint(uint64_t cellid, uint64_t rankingpoint) {
+        geotilerank_index ranks(_self, _self.value);
+        auto bycellrank = ranks.get_index<"cellrank"_n>();
+        auto iterator = bycellrank.find(get_cell_rankingpoint_key(cellid, rankingpoint));
+        if(iterator == bycellrank.end())
+            return;
+
+        if(iterator->treasurecount <= 1) {
+            bycellrank.erase(iterator);
+        }
+        else {
+            bycellrank.modify(iterator, same_payer, [&]( auto& row ) {
+                row.treasurecount -= 1;
+            });
+        }
+    }
+
+    //Highest rankingpoint in a cell: the last cellrank key before the first key of the next cell
+    uint64_t get_geotile_maxrankingpoint(uint64_t cellid) {
+        geotilerank_index ranks(_self, _self.value);
+        auto bycellrank = ranks.get_index<"cellrank"_n>();
+        auto iterator = bycellrank.lower_bound(get_cell_rankingpoint_key(cellid + 1, 0));
+        if(iterator == bycellrank.begin())
+            return 0;
+
+        --iterator;
+        return iterator->cellid == cellid ? iterator->rankingpoint : 0;
+    }
+    //-----------------------------------------------------------------------------------------------------
+
     //---Get dapp settings---------------------------------------------------------------------------------
     asset getEosUsdPrice() {
         asset eosusd = eosio::asset(0, symbol(symbol_code("USD"), 4)); //default value
@@ -644,23 +1003,6 @@ private:
         return eosio::asset(priceInEOS, symbol(symbol_code("EOS"), 4));
     };
     //-----------------------------------------------------------------------------------------------------
-
-    static constexpr uint64_t string_to_symbol( uint8_t precision, const char* str ) {
-        uint32_t len = 0;
-        while( str[len] ) ++len;
-
-        uint64_t result = 0;
-        for( uint32_t i = 0; i < len; ++i ) {
-            if( str[i] < 'A' || str[i] > 'Z' ) {
-                /// ERRORS?
-            } else {
-                result |= (uint64_t(str[i]) << (8*(1+i)));
-            }
-        }
-
-        result |= uint64_t(precision);
-        return result;
-    }
 };
 
 //EOSIO_DISPATCH( cptblackbill, (create)(issue)(transfer)(addtreasure)(erasetreasur)(modtreasure)(checktreasur)(modtrchest))
@@ -681,6 +1023,12 @@ extern "C" {
     else if(code==receiver && action==name("erasetreasur").value) {
       execute_action(name(receiver), name(code), &cptblackbill::erasetreasur );
     }
+    else if(code==receiver && action==name("reindexkw").value) {
+      execute_action(name(receiver), name(code), &cptblackbill::reindexkw );
+    }
+    else if(code==receiver && action==name("backfillgeo").value) {
+      execute_action(name(receiver), name(code), &cptblackbill::backfillgeo );
+    }
     else if(code==receiver && action==name("addsetting").value) {
       execute_action(name(receiver), name(code), &cptblackbill::addsetting );
     }
@@ -6,7 +6,5 @@
 
 #include <eosiolib/eosio.hpp>
 #include <eosiolib/asset.hpp>
-#include <eosiolib/print.hpp>
-#include <eosiolib/crypto.h>
 #include <string>
-#include <cmath>
+#include <cstdlib>
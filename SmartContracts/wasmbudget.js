@@ -0,0 +1,155 @@
+// Checks contract .wasm files against the size and instantiation budget in wasmbudget.json.
+//
+//   node wasmbudget.js <file.wasm> [<file.wasm> ...]
+//   node wasmbudget.js --record <file.wasm> [<file.wasm> ...]
+//
+// Compile and instantiate times are measured with the WebAssembly engine of node (V8), with stub functions for the
+// eosio intrinsics, and reported as the median of WASMBUDGET_RUNS runs. Lazy compilation is turned off so the whole
+// module is compiled up front, like a node's JIT does on first use of a contract.
+// Budgets are looked up by the path of the file relative to this directory (e.g. size/challenges.wasm), so the default
+// and the size-optimized build of a contract each have their own. Exits 1 when a file is over its byte budget or its
+// budget has not been measured yet, so a size regression fails the build. Load time depends on the machine and its
+// load, so going over maxLoadMs only prints a warning.
+// --record measures the files and writes their budgets: the measured size plus RECORD_BYTES_HEADROOM and twice the
+// measured load time. Run it (make record-budget) on a real build and commit wasmbudget.json with the contract change.
+
+var fs = require('fs');
+var path = require('path');
+var v8 = require('v8');
+
+v8.setFlagsFromString('--no-wasm-lazy-compilation');
+
+var RUNS = parseInt(process.env.WASMBUDGET_RUNS || '25', 10);
+var RECORD_BYTES_HEADROOM = 0.05;
+var BUDGET_FILE = path.join(__dirname, 'wasmbudget.json');
+var budgets = JSON.parse(fs.readFileSync(BUDGET_FILE));
+
+function budgetKey(file) {
+    return path.relative(__dirname, path.resolve(file)).split(path.sep).join('/');
+}
+
+function median(values) {
+    var sorted = values.slice().sort((a, b) => a - b);
+    return sorted[Math.floor(sorted.length / 2)];
+}
+
+//V8 reuses the compiled code of identical module bytes, so every run appends a differently named custom section
+function uniqueBytes(bytes, run) {
+    var name = Buffer.from('wasmbudget' + run);
+    var section = Buffer.concat([Buffer.from([0, name.length + 1, name.length]), name]);
+    return Buffer.concat([bytes, section]);
+}
+
+function stubImports(module) {
+    var imports = {};
+    WebAssembly.Module.imports(module).forEach(i => {
+        imports[i.module] = imports[i.module] || {};
+        if (i.kind == 'function') {
+            imports[i.module][i.name] = () => 0;
+        } else if (i.kind == 'memory') {
+            imports[i.module][i.name] = new WebAssembly.Memory({ initial: 1 });
+        } else {
+            throw new Error('Unsupported import ' + i.module + '.' + i.name + ' of kind ' + i.kind);
+        }
+    });
+    return imports;
+}
+
+function measure(file) {
+    var bytes = fs.readFileSync(file);
+    var compileMs = [];
+    var instantiateMs = [];
+
+    for (var run = 0; run < RUNS; run++) {
+        var runBytes = uniqueBytes(bytes, run);
+        var start = process.hrtime.bigint();
+        var module = new WebAssembly.Module(runBytes);
+        var compiled = process.hrtime.bigint();
+        new WebAssembly.Instance(module, stubImports(module));
+        var instantiated = process.hrtime.bigint();
+
+        compileMs.push(Number(compiled - start) / 1e6);
+        instantiateMs.push(Number(instantiated - compiled) / 1e6);
+    }
+
+    return { bytes: bytes.length, compileMs: median(compileMs), instantiateMs: median(instantiateMs) };
+}
+
+function record(files) {
+    var failed = false;
+    files.forEach(file => {
+        var name = budgetKey(file);
+        var result;
+        try {
+            result = measure(file);
+        } catch (e) {
+            console.log(name + ': ' + e.message);
+            failed = true;
+            return;
+        }
+        var loadMs = result.compileMs + result.instantiateMs;
+        budgets[name] = {
+            measuredBytes: result.bytes,
+            maxBytes: Math.ceil(result.bytes * (1 + RECORD_BYTES_HEADROOM)),
+            maxLoadMs: Math.max(1, Math.ceil(loadMs * 2))
+        };
+        console.log(name + ': ' + result.bytes + ' bytes, load ' + loadMs.toFixed(2) + ' ms, recorded ' + JSON.stringify(budgets[name]));
+    });
+    if (failed) {
+        return 1;
+    }
+    fs.writeFileSync(BUDGET_FILE, JSON.stringify(budgets, null, 4) + '\n');
+    return 0;
+}
+
+function main(args) {
+    var recording = args[0] == '--record';
+    var files = recording ? args.slice(1) : args;
+    if (files.length == 0) {
+        console.error('usage: node wasmbudget.js [--record] <file.wasm> [<file.wasm> ...]');
+        return 2;
+    }
+    if (recording) {
+        return record(files);
+    }
+
+    var failed = false;
+    files.forEach(file => {
+        var name = budgetKey(file);
+        var budget = budgets[name];
+        var problems = [];
+        var warnings = [];
+        var result;
+        try {
+            result = measure(file);
+        } catch (e) {
+            console.log(name + ': ' + e.message);
+            failed = true;
+            return;
+        }
+
+        if (!budget) {
+            problems.push('no budget in wasmbudget.json');
+        } else if (!budget.measuredBytes) {
+            problems.push('budget not measured yet, run make record-budget on a real build');
+            budget = null;
+        } else {
+            if (result.bytes > budget.maxBytes) {
+                problems.push('size ' + result.bytes + ' > ' + budget.maxBytes + ' bytes');
+            }
+            if (result.compileMs + result.instantiateMs > budget.maxLoadMs) {
+                warnings.push('load ' + (result.compileMs + result.instantiateMs).toFixed(2) + ' > ' + budget.maxLoadMs + ' ms');
+            }
+        }
+
+        console.log(name + ': ' + result.bytes + ' bytes' + (budget ? ' (budget ' + budget.maxBytes + ')' : '') +
+            ', compile ' + result.compileMs.toFixed(2) + ' ms, instantiate ' + result.instantiateMs.toFixed(2) + ' ms' +
+            (budget ? ' (budget ' + budget.maxLoadMs + ' ms)' : '') +
+            (problems.length ? '  OVER BUDGET: ' + problems.join(', ') : '  ok') +
+            (warnings.length ? '  WARNING: ' + warnings.join(', ') : ''));
+        failed = failed || problems.length > 0;
+    });
+    return failed ? 1 : 0;
+}
+
+process.exitCode = main(process.argv.slice(2));
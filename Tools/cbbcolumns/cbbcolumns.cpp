@@ -0,0 +1,321 @@
+/**
+ *  @file
+ *  cbbcolumns - export cptblackbill table rows to a columnar file and scan it locally.
+ *
+ *  cbbcolumns export <table> <input> <output> [--scope <name>]
+ *      Decodes serialized rows of treasure, results or accounts. Input is either get_table_rows output
+ *      requested with "json": false (one or more pages, hex rows under "rows"), or a dump with one row per
+ *      line as "[<scope>] <hex>". --scope sets the scope for rows that do not carry one.
+ *  cbbcolumns info <file>
+ *  cbbcolumns head <file> [rows]
+ *  cbbcolumns stats <file> <column>
+ *      count, min, max, sum and mean of a numeric column
+ *  cbbcolumns count <file> <column> <min> <max> [<column> <min> <max> ...]
+ *      rows where every column is within its inclusive range, e.g. a latitude/longitude box
+ */
+#include "columnfile.hpp"
+#include "tablelayouts.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+using namespace cbbcolumns;
+
+static const uint64_t scan_block_rows = 4096;
+
+static int hex_value(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static std::vector<uint8_t> parse_hex(const std::string& hex) {
+    if(hex.size() % 2 != 0)
+        throw std::runtime_error("Odd number of hex digits in row");
+
+    std::vector<uint8_t> bytes(hex.size() / 2);
+    for(size_t i = 0; i < bytes.size(); ++i) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if(hi < 0 || lo < 0)
+            throw std::runtime_error("Invalid hex digit in row");
+        bytes[i] = (hi << 4) | lo;
+    }
+    return bytes;
+}
+
+struct input_row {
+    uint64_t scope;
+    std::string hex;
+};
+
+//Hex strings of every "rows" array in get_table_rows output (pages can be concatenated)
+static void read_json_rows(const std::string& text, uint64_t scope, std::vector<input_row>& rows) {
+    size_t pos = 0;
+    while((pos = text.find("\"rows\"", pos)) != std::string::npos) {
+        pos = text.find('[', pos);
+        if(pos == std::string::npos)
+            break;
+        size_t end = text.find(']', pos);
+        if(end == std::string::npos)
+            throw std::runtime_error("Unterminated rows array");
+
+        size_t quote = text.find('"', pos);
+        while(quote != std::string::npos && quote < end) {
+            size_t close = text.find('"', quote + 1);
+            rows.push_back({ scope, text.substr(quote + 1, close - quote - 1) });
+            quote = text.find('"', close + 1);
+        }
+        pos = end;
+    }
+}
+
+static void read_line_rows(std::istream& in, uint64_t scope, std::vector<input_row>& rows) {
+    std::string line;
+    while(std::getline(in, line)) {
+        std::istringstream tokens(line);
+        std::string first, second;
+        tokens >> first >> second;
+        if(first.empty())
+            continue;
+        if(second.empty())
+            rows.push_back({ scope, first });
+        else
+            rows.push_back({ string_to_name(first), second });
+    }
+}
+
+static int export_table(const std::string& table, const std::string& input, const std::string& output, uint64_t scope) {
+    const table_layout& layout = find_table_layout(table);
+
+    std::ifstream in(input, std::ios::binary);
+    if(!in)
+        throw std::runtime_error("Cannot open " + input);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    std::vector<input_row> rows;
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if(first != std::string::npos && text[first] == '{') {
+        read_json_rows(text, scope, rows);
+    } else {
+        std::istringstream lines(text);
+        read_line_rows(lines, scope, rows);
+    }
+
+    std::vector<column_builder> columns = make_columns(layout);
+    for(size_t i = 0; i < rows.size(); ++i) {
+        try {
+            decode_row(layout, rows[i].scope, parse_hex(rows[i].hex), columns);
+        } catch(const std::exception& e) {
+            throw std::runtime_error("Row " + std::to_string(i + 1) + ": " + e.what());
+        }
+    }
+
+    write_column_file(output, rows.size(), columns);
+    std::printf("Exported %zu %s rows, %zu columns to %s\n", rows.size(), table.c_str(), columns.size(), output.c_str());
+    return 0;
+}
+
+static int info(const column_file& file) {
+    std::printf("%" PRIu64 " rows, %u columns\n", file.rows(), file.column_count());
+    for(uint32_t i = 0; i < file.column_count(); ++i) {
+        const column_header& c = file.column(i);
+        std::printf("  %-28s %-8s %12" PRIu64 " bytes\n", c.name, type_name((column_type)c.type), c.bytes + c.blob_bytes);
+    }
+    return 0;
+}
+
+static std::string format_value(const column_file& file, uint32_t column, uint64_t row) {
+    switch((column_type)file.column(column).type) {
+        case column_type::uint64:  return std::to_string(file.values<uint64_t>(column)[row]);
+        case column_type::int64:   return std::to_string(file.values<int64_t>(column)[row]);
+        case column_type::uint32:  return std::to_string(file.values<uint32_t>(column)[row]);
+        case column_type::int32:   return std::to_string(file.values<int32_t>(column)[row]);
+        case column_type::float64: return std::to_string(file.values<double>(column)[row]);
+        case column_type::name:    return name_to_string(file.values<uint64_t>(column)[row]);
+        case column_type::string:  return "\"" + file.string_value(column, row) + "\"";
+    }
+    return "";
+}
+
+static int head(const column_file& file, uint64_t count) {
+    for(uint64_t row = 0; row < std::min(count, file.rows()); ++row) {
+        std::printf("#%" PRIu64 "\n", row);
+        for(uint32_t i = 0; i < file.column_count(); ++i)
+            std::printf("  %s: %s\n", file.column(i).name, format_value(file, i, row).c_str());
+    }
+    return 0;
+}
+
+static std::string sum_to_string(double sum) {
+    std::ostringstream out;
+    out.precision(17);
+    out << sum;
+    return out.str();
+}
+
+static std::string sum_to_string(int64_t sum) { return std::to_string(sum); }
+static std::string sum_to_string(uint64_t sum) { return std::to_string(sum); }
+
+//64-bit columns are summed in 128 bits so totals of millions of asset amounts can not overflow
+static std::string sum_to_string(unsigned __int128 sum) {
+    std::string digits;
+    do {
+        digits.insert(digits.begin(), char('0' + (int)(sum % 10)));
+        sum /= 10;
+    } while(sum > 0);
+    return digits;
+}
+
+static std::string sum_to_string(__int128 sum) {
+    return sum < 0 ? "-" + sum_to_string(-(unsigned __int128)sum) : sum_to_string((unsigned __int128)sum);
+}
+
+template<typename T, typename Sum>
+static void column_stats(const T* values, uint64_t rows) {
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    Sum sum = 0;
+    for(uint64_t i = 0; i < rows; ++i) { //Branch free min/max/sum, vectorized by the compiler
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+        sum += values[i];
+    }
+
+    std::ostringstream out;
+    out.precision(17);
+    out << "count " << rows;
+    if(rows > 0)
+        out << "\nmin " << +min << "\nmax " << +max << "\nsum " << sum_to_string(sum) << "\nmean " << (double)sum / rows;
+    std::printf("%s\n", out.str().c_str());
+}
+
+static int stats(const column_file& file, const std::string& name) {
+    uint32_t column = file.find(name);
+    uint64_t rows = file.rows();
+    switch((column_type)file.column(column).type) {
+        case column_type::uint64:  column_stats<uint64_t, unsigned __int128>(file.values<uint64_t>(column), rows); break;
+        case column_type::int64:   column_stats<int64_t, __int128>(file.values<int64_t>(column), rows); break;
+        case column_type::uint32:  column_stats<uint32_t, uint64_t>(file.values<uint32_t>(column), rows); break;
+        case column_type::int32:   column_stats<int32_t, int64_t>(file.values<int32_t>(column), rows); break;
+        case column_type::float64: column_stats<double, double>(file.values<double>(column), rows); break;
+        default:
+            throw std::runtime_error("Column " + name + " is not numeric");
+    }
+    return 0;
+}
+
+//Clears mask[i] for rows outside [min, max]
+template<typename T>
+static void filter_block(const T* values, uint64_t rows, T min, T max, uint8_t* mask) {
+    for(uint64_t i = 0; i < rows; ++i)
+        mask[i] &= (uint8_t)((values[i] >= min) & (values[i] <= max));
+}
+
+struct range_filter {
+    uint32_t column;
+    column_type type;
+    std::string min;
+    std::string max;
+};
+
+template<typename T>
+static T parse_bound(const std::string& value, column_type type) {
+    if(type == column_type::name)
+        return (T)string_to_name(value);
+    if(type == column_type::float64)
+        return (T)std::stod(value);
+    if(std::is_signed<T>::value)
+        return (T)std::stoll(value);
+    return (T)std::stoull(value);
+}
+
+template<typename T>
+static void apply_filter(const column_file& file, const range_filter& f, uint64_t begin, uint64_t rows, uint8_t* mask) {
+    filter_block<T>(file.values<T>(f.column) + begin, rows, parse_bound<T>(f.min, f.type), parse_bound<T>(f.max, f.type), mask);
+}
+
+static int count(const column_file& file, const std::vector<range_filter>& filters) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> mask(scan_block_rows);
+    uint64_t matches = 0;
+    for(uint64_t begin = 0; begin < file.rows(); begin += scan_block_rows) {
+        uint64_t rows = std::min(scan_block_rows, file.rows() - begin);
+        std::fill(mask.begin(), mask.begin() + rows, 1);
+
+        for(const range_filter& f : filters) {
+            switch(f.type) {
+                case column_type::uint64:
+                case column_type::name:    apply_filter<uint64_t>(file, f, begin, rows, mask.data()); break;
+                case column_type::int64:   apply_filter<int64_t>(file, f, begin, rows, mask.data()); break;
+                case column_type::uint32:  apply_filter<uint32_t>(file, f, begin, rows, mask.data()); break;
+                case column_type::int32:   apply_filter<int32_t>(file, f, begin, rows, mask.data()); break;
+                case column_type::float64: apply_filter<double>(file, f, begin, rows, mask.data()); break;
+                default:
+                    throw std::runtime_error("Column " + std::string(file.column(f.column).name) + " can not be range filtered");
+            }
+        }
+
+        for(uint64_t i = 0; i < rows; ++i)
+            matches += mask[i];
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%" PRIu64 " of %" PRIu64 " rows match (%.2f ms)\n", matches, file.rows(), ms);
+    return 0;
+}
+
+static int usage() {
+    std::fprintf(stderr,
+        "usage: cbbcolumns export <treasure|results|accounts> <input> <output> [--scope <name>]\n"
+        "       cbbcolumns info <file>\n"
+        "       cbbcolumns head <file> [rows]\n"
+        "       cbbcolumns stats <file> <column>\n"
+        "       cbbcolumns count <file> <column> <min> <max> [<column> <min> <max> ...]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if(args.size() < 2)
+        return usage();
+
+    try {
+        const std::string& command = args[0];
+        if(command == "export") {
+            if(args.size() != 4 && !(args.size() == 6 && args[4] == "--scope"))
+                return usage();
+            return export_table(args[1], args[2], args[3], args.size() == 6 ? string_to_name(args[5]) : 0);
+        }
+
+        column_file file(args[1]);
+        if(command == "info")
+            return info(file);
+        if(command == "head")
+            return head(file, args.size() > 2 ? std::stoull(args[2]) : 5);
+        if(command == "stats" && args.size() == 3)
+            return stats(file, args[2]);
+        if(command == "count" && args.size() >= 5 && (args.size() - 2) % 3 == 0) {
+            std::vector<range_filter> filters;
+            for(size_t i = 2; i < args.size(); i += 3) {
+                uint32_t column = file.find(args[i]);
+                filters.push_back({ column, (column_type)file.column(column).type, args[i + 1], args[i + 2] });
+            }
+            return count(file, filters);
+        }
+        return usage();
+    } catch(const std::exception& e) {
+        std::fprintf(stderr, "cbbcolumns: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,236 @@
+#include "columnfile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <stdexcept>
+
+namespace cbbcolumns {
+
+    const char* type_name(column_type type) {
+        switch(type) {
+            case column_type::uint64:  return "uint64";
+            case column_type::int64:   return "int64";
+            case column_type::uint32:  return "uint32";
+            case column_type::int32:   return "int32";
+            case column_type::float64: return "float64";
+            case column_type::name:    return "name";
+            case column_type::string:  return "string";
+        }
+        return "unknown";
+    }
+
+    std::string name_to_string(uint64_t value) {
+        static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+        std::string str(13, '.');
+
+        uint64_t tmp = value;
+        for(int i = 0; i <= 12; ++i) {
+            char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+            str[12 - i] = c;
+            tmp >>= (i == 0 ? 4 : 5);
+        }
+
+        size_t last = str.find_last_not_of('.');
+        return last == std::string::npos ? std::string() : str.substr(0, last + 1);
+    }
+
+    uint64_t string_to_name(const std::string& str) {
+        auto char_to_symbol = [](char c) -> uint64_t {
+            if(c >= 'a' && c <= 'z')
+                return (c - 'a') + 6;
+            if(c >= '1' && c <= '5')
+                return (c - '1') + 1;
+            return 0;
+        };
+
+        uint64_t value = 0;
+        for(size_t i = 0; i <= 12; ++i) {
+            uint64_t c = i < str.size() ? char_to_symbol(str[i]) : 0;
+            if(i < 12)
+                value |= (c & 0x1f) << (64 - 5 * (i + 1));
+            else
+                value |= c & 0x0f;
+        }
+        return value;
+    }
+
+    uint64_t type_width(column_type type) {
+        switch(type) {
+            case column_type::uint64:
+            case column_type::int64:
+            case column_type::float64:
+            case column_type::name:
+            case column_type::string:  return 8; //String columns hold uint64 offsets
+            case column_type::uint32:
+            case column_type::int32:   return 4;
+        }
+        return 0;
+    }
+
+    column_builder::column_builder(const std::string& name, column_type type) : name(name), type(type) {
+        if(type == column_type::string)
+            offsets.push_back(0);
+    }
+
+    void column_builder::push_string(const std::string& value) {
+        blob += value;
+        offsets.push_back(blob.size());
+    }
+
+    static uint64_t align(uint64_t offset) {
+        return (offset + region_alignment - 1) / region_alignment * region_alignment;
+    }
+
+    void write_column_file(const std::string& path, uint64_t rows, const std::vector<column_builder>& columns) {
+        file_header header = {};
+        std::memcpy(header.magic, file_magic, sizeof(file_magic));
+        header.rows = rows;
+        header.columns = columns.size();
+
+        //Place the data regions after the headers
+        std::vector<column_header> headers(columns.size());
+        uint64_t offset = align(sizeof(file_header) + sizeof(column_header) * columns.size());
+        for(size_t i = 0; i < columns.size(); ++i) {
+            const column_builder& c = columns[i];
+            if(c.name.size() >= sizeof(headers[i].name))
+                throw std::runtime_error("Column name too long: " + c.name);
+
+            std::memset(&headers[i], 0, sizeof(column_header));
+            std::memcpy(headers[i].name, c.name.c_str(), c.name.size());
+            headers[i].type = (uint32_t)c.type;
+            headers[i].offset = offset;
+            if(c.type == column_type::string) {
+                headers[i].bytes = c.offsets.size() * sizeof(uint64_t);
+                headers[i].blob_offset = align(offset + headers[i].bytes);
+                headers[i].blob_bytes = c.blob.size();
+                offset = align(headers[i].blob_offset + headers[i].blob_bytes);
+            } else {
+                headers[i].bytes = c.values.size();
+                offset = align(offset + headers[i].bytes);
+            }
+        }
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out)
+            throw std::runtime_error("Cannot create " + path);
+
+        uint64_t written = 0;
+        auto write = [&](const void* data, uint64_t bytes) {
+            out.write((const char*)data, bytes);
+            written += bytes;
+        };
+        auto pad_to = [&](uint64_t target) {
+            static const char zeros[region_alignment] = {};
+            while(written < target)
+                write(zeros, std::min<uint64_t>(region_alignment, target - written));
+        };
+
+        write(&header, sizeof(header));
+        write(headers.data(), sizeof(column_header) * headers.size());
+        for(size_t i = 0; i < columns.size(); ++i) {
+            pad_to(headers[i].offset);
+            if(columns[i].type == column_type::string) {
+                write(columns[i].offsets.data(), headers[i].bytes);
+                pad_to(headers[i].blob_offset);
+                write(columns[i].blob.data(), headers[i].blob_bytes);
+            } else {
+                write(columns[i].values.data(), headers[i].bytes);
+            }
+        }
+        pad_to(offset);
+
+        if(!out)
+            throw std::runtime_error("Failed writing " + path);
+    }
+
+    column_file::column_file(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            throw std::runtime_error("Cannot open " + path);
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(file_header)) {
+            ::close(fd);
+            throw std::runtime_error(path + " is not a column file");
+        }
+        size = st.st_size;
+
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED)
+            throw std::runtime_error("Cannot map " + path);
+        base = (const uint8_t*)mapping;
+
+        header = (const file_header*)base;
+        columns = (const column_header*)(base + sizeof(file_header));
+        if(std::memcmp(header->magic, file_magic, sizeof(file_magic)) != 0 ||
+           sizeof(file_header) + sizeof(column_header) * header->columns > size) {
+            munmap((void*)base, size);
+            throw std::runtime_error(path + " is not a column file");
+        }
+
+        for(uint32_t i = 0; i < header->columns; ++i) {
+            std::string problem = check_column(columns[i]);
+            if(!problem.empty()) {
+                munmap((void*)base, size);
+                throw std::runtime_error(path + ": column " + std::to_string(i) + " " + problem);
+            }
+        }
+    }
+
+    //Every region must lie inside the mapping and hold exactly rows values, so values<T>()[row] and
+    //string_value() never read past the file. String offsets must also stay inside their blob.
+    std::string column_file::check_column(const column_header& c) const {
+        auto inside = [&](uint64_t offset, uint64_t bytes) {
+            return offset <= size && bytes <= size - offset;
+        };
+        if(!inside(c.offset, c.bytes))
+            return "is truncated";
+
+        uint64_t rows = header->rows;
+        uint64_t width = type_width((column_type)c.type);
+        if(width == 0)
+            return "has unknown type " + std::to_string(c.type);
+
+        uint64_t values = (column_type)c.type == column_type::string ? rows + 1 : rows;
+        if(values < rows || c.bytes % width != 0 || c.bytes / width != values)
+            return "holds " + std::to_string(c.bytes) + " bytes, expected " + std::to_string(values) + " values of " + std::to_string(width) + " bytes";
+        if((column_type)c.type != column_type::string)
+            return "";
+
+        if(!inside(c.blob_offset, c.blob_bytes))
+            return "string data is truncated";
+
+        const uint64_t* offsets = (const uint64_t*)(base + c.offset);
+        if(offsets[0] != 0 || offsets[rows] != c.blob_bytes)
+            return "string offsets do not match the string data";
+        for(uint64_t row = 0; row < rows; ++row) {
+            if(offsets[row] > offsets[row + 1])
+                return "string offsets are not in order";
+        }
+        return "";
+    }
+
+    column_file::~column_file() {
+        if(base)
+            munmap((void*)base, size);
+    }
+
+    uint32_t column_file::find(const std::string& name) const {
+        for(uint32_t i = 0; i < header->columns; ++i) {
+            if(name == std::string(columns[i].name, strnlen(columns[i].name, sizeof(columns[i].name))))
+                return i;
+        }
+        throw std::runtime_error("No column named " + name);
+    }
+
+    std::string column_file::string_value(uint32_t index, uint64_t row) const {
+        const uint64_t* offsets = values<uint64_t>(index);
+        const char* blob = (const char*)(base + columns[index].blob_offset);
+        return std::string(blob + offsets[row], offsets[row + 1] - offsets[row]);
+    }
+}
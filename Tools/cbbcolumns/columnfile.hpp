@@ -0,0 +1,110 @@
+/**
+ *  @file
+ *  Memory-mapped columnar file with one column per table field.
+ *
+ *  Layout (little endian):
+ *    file_header
+ *    column_header[columns]
+ *    column data, every region aligned to 64 bytes so scans can use aligned vector loads
+ *
+ *  Fixed width columns store rows values back to back. String columns store rows + 1 uint64 offsets
+ *  into a blob region holding the concatenated UTF-8 bytes.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace cbbcolumns {
+
+    enum class column_type : uint32_t {
+        uint64 = 1,
+        int64 = 2,
+        uint32 = 3,
+        int32 = 4,
+        float64 = 5,
+        name = 6,    //eosio::name, stored as its uint64 value
+        string = 7
+    };
+
+    static const char file_magic[8] = { 'C', 'B', 'B', 'C', 'O', 'L', '0', '1' };
+    static const uint64_t region_alignment = 64;
+
+    struct file_header {
+        char magic[8];
+        uint64_t rows;
+        uint32_t columns;
+        uint32_t reserved;
+    };
+
+    struct column_header {
+        char name[48];
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t offset;      //Values, or offsets for string columns
+        uint64_t bytes;
+        uint64_t blob_offset; //String columns only
+        uint64_t blob_bytes;
+    };
+
+    const char* type_name(column_type type);
+    uint64_t type_width(column_type type); //Bytes per value, 0 for an unknown type
+    std::string name_to_string(uint64_t value);
+    uint64_t string_to_name(const std::string& str);
+
+    //Column being filled row by row before it is written
+    struct column_builder {
+        std::string name;
+        column_type type;
+        std::vector<uint8_t> values;
+        std::vector<uint64_t> offsets;
+        std::string blob;
+
+        column_builder(const std::string& name, column_type type);
+
+        template<typename T>
+        void push(T value) {
+            size_t at = values.size();
+            values.resize(at + sizeof(T));
+            std::memcpy(values.data() + at, &value, sizeof(T));
+        }
+
+        void push_string(const std::string& value);
+    };
+
+    void write_column_file(const std::string& path, uint64_t rows, const std::vector<column_builder>& columns);
+
+    //Read-only view of a column file. The whole file is mapped, columns are pointers into the mapping.
+    class column_file {
+    public:
+        explicit column_file(const std::string& path);
+        ~column_file();
+
+        column_file(const column_file&) = delete;
+        column_file& operator=(const column_file&) = delete;
+
+        uint64_t rows() const { return header->rows; }
+        uint32_t column_count() const { return header->columns; }
+        const column_header& column(uint32_t index) const { return columns[index]; }
+
+        //Index of the named column, throws if it does not exist
+        uint32_t find(const std::string& name) const;
+
+        template<typename T>
+        const T* values(uint32_t index) const {
+            return reinterpret_cast<const T*>(base + columns[index].offset);
+        }
+
+        std::string string_value(uint32_t index, uint64_t row) const;
+
+    private:
+        std::string check_column(const column_header& c) const; //Empty when the column is consistent with the header
+
+        const uint8_t* base = nullptr;
+        size_t size = 0;
+        const file_header* header = nullptr;
+        const column_header* columns = nullptr;
+    };
+}
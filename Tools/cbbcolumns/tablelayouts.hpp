@@ -0,0 +1,178 @@
+/**
+ *  @file
+ *  Binary row layouts of the cptblackbill tables, in the field order the contract serializes them.
+ *  Keep in sync with the table structs in SmartContracts/cptblackbill.cpp.
+ */
+#pragma once
+
+#include "columnfile.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cbbcolumns {
+
+    enum class field_type {
+        uint64,
+        int32,
+        uint32,
+        float64,
+        name,
+        string,
+        asset   //int64 amount + uint64 symbol, exported as <field>.amount and <field>.symbol
+    };
+
+    struct field {
+        const char* name;
+        field_type type;
+    };
+
+    struct table_layout {
+        const char* table;
+        std::vector<field> fields;
+    };
+
+    inline const std::vector<table_layout>& table_layouts() {
+        static const std::vector<table_layout> layouts = {
+            { "treasure", {
+                { "pkey", field_type::uint64 },
+                { "owner", field_type::name },
+                { "title", field_type::string },
+                { "description", field_type::string },
+                { "imageurl", field_type::string },
+                { "treasuremapurl", field_type::string },
+                { "videourl", field_type::string },
+                { "latitude", field_type::float64 },
+                { "longitude", field_type::float64 },
+                { "prechesttransfer", field_type::asset },
+                { "rankingpoint", field_type::uint64 },
+                { "timestamp", field_type::int32 },
+                { "expirationdate", field_type::int32 },
+                { "status", field_type::string },
+                { "jsondata", field_type::string } } },
+            { "results", {
+                { "pkey", field_type::uint64 },
+                { "treasurepkey", field_type::uint64 },
+                { "user", field_type::name },
+                { "creator", field_type::name },
+                { "trxid", field_type::string },
+                { "payouteos", field_type::asset },
+                { "eosusdprice", field_type::asset },
+                { "minedblkbills", field_type::asset },
+                { "timestamp", field_type::int32 } } },
+            { "accounts", {
+                { "balance", field_type::asset } } }
+        };
+        return layouts;
+    }
+
+    inline const table_layout& find_table_layout(const std::string& table) {
+        for(const table_layout& layout : table_layouts()) {
+            if(table == layout.table)
+                return layout;
+        }
+        throw std::runtime_error("Unknown table " + table + " (supported: treasure, results, accounts)");
+    }
+
+    //Reads one serialized row
+    class row_reader {
+    public:
+        row_reader(const uint8_t* data, size_t size) : pos(data), end(data + size) {}
+
+        template<typename T>
+        T read() {
+            check(sizeof(T));
+            T value;
+            std::memcpy(&value, pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+        uint32_t read_varuint32() {
+            uint32_t value = 0;
+            for(int shift = 0; shift < 35; shift += 7) {
+                uint8_t b = read<uint8_t>();
+                value |= uint32_t(b & 0x7f) << shift;
+                if(!(b & 0x80))
+                    return value;
+            }
+            throw std::runtime_error("Invalid varuint32 in row");
+        }
+
+        std::string read_string() {
+            uint32_t length = read_varuint32();
+            check(length);
+            std::string value((const char*)pos, length);
+            pos += length;
+            return value;
+        }
+
+        bool at_end() const { return pos == end; }
+
+    private:
+        void check(size_t bytes) {
+            if((size_t)(end - pos) < bytes)
+                throw std::runtime_error("Row is shorter than the table layout");
+        }
+
+        const uint8_t* pos;
+        const uint8_t* end;
+    };
+
+    //One column per field, plus a leading scope column
+    inline std::vector<column_builder> make_columns(const table_layout& layout) {
+        std::vector<column_builder> columns;
+        columns.emplace_back("scope", column_type::name);
+        for(const field& f : layout.fields) {
+            std::string name = f.name;
+            switch(f.type) {
+                case field_type::uint64:  columns.emplace_back(name, column_type::uint64); break;
+                case field_type::int32:   columns.emplace_back(name, column_type::int32); break;
+                case field_type::uint32:  columns.emplace_back(name, column_type::uint32); break;
+                case field_type::float64: columns.emplace_back(name, column_type::float64); break;
+                case field_type::name:    columns.emplace_back(name, column_type::name); break;
+                case field_type::string:  columns.emplace_back(name, column_type::string); break;
+                case field_type::asset:
+                    columns.emplace_back(name + ".amount", column_type::int64);
+                    columns.emplace_back(name + ".symbol", column_type::uint64);
+                    break;
+            }
+        }
+        return columns;
+    }
+
+    inline void decode_row(const table_layout& layout, uint64_t scope, const std::vector<uint8_t>& row, std::vector<column_builder>& columns) {
+        row_reader reader(row.data(), row.size());
+
+        //Decode the whole row first so a bad row does not leave the columns with different lengths
+        std::vector<uint64_t> words;
+        std::vector<std::string> strings;
+        for(const field& f : layout.fields) {
+            switch(f.type) {
+                case field_type::int32:
+                case field_type::uint32:  words.push_back(reader.read<uint32_t>()); break;
+                case field_type::string:  strings.push_back(reader.read_string()); break;
+                case field_type::asset:   words.push_back(reader.read<uint64_t>()); words.push_back(reader.read<uint64_t>()); break;
+                default:                  words.push_back(reader.read<uint64_t>()); break;
+            }
+        }
+        if(!reader.at_end())
+            throw std::runtime_error("Row is longer than the table layout");
+
+        columns[0].push<uint64_t>(scope);
+        size_t column = 1, word = 0, str = 0;
+        for(const field& f : layout.fields) {
+            switch(f.type) {
+                case field_type::int32:
+                case field_type::uint32:  columns[column++].push<uint32_t>((uint32_t)words[word++]); break;
+                case field_type::string:  columns[column++].push_string(strings[str++]); break;
+                case field_type::asset:
+                    columns[column++].push<uint64_t>(words[word++]);
+                    columns[column++].push<uint64_t>(words[word++]);
+                    break;
+                default:                  columns[column++].push<uint64_t>(words[word++]); break;
+            }
+        }
+    }
+}
@@ -0,0 +1,124 @@
+// Micro-batching of relay actions.
+// Requests from the same actor on the same endpoint/chain/key provider that arrive within RELAY_BATCH_WINDOW_MS
+// are signed and pushed as one transaction. With the default window of 0 every request is pushed on its own.
+
+var BATCH_WINDOW_MS = parseInt(process.env.RELAY_BATCH_WINDOW_MS || '0', 10);
+var MAX_BATCH_ACTIONS = parseInt(process.env.RELAY_BATCH_MAX_ACTIONS || '16', 10);
+
+var pendingBatches = {};
+
+function pushTransaction(eos, actions, callback) {
+    eos.transaction({ actions: actions }).then(value => callback(null, value), err => callback(err));
+}
+
+//True when the node executed the transaction and rejected it because of one of its actions (an eosio_assert,
+//bad action data or missing authorization). Only then is it safe to push the requests again on their own.
+//Timeouts, network errors and other node errors may come after the transaction was accepted, and a retry
+//with new headers would execute the actions a second time.
+//eosjs fails with the body of the chain API error, e.g. {"code":500,"error":{"code":3050003,...}}, either as
+//a string or as the message of an Error
+function isActionRejection(err) {
+    var body;
+    try {
+        body = JSON.parse(typeof err == 'string' ? err : err && err.message);
+    } catch (e) {
+        return false;
+    }
+    var code = body && body.error && body.error.code;
+    if (typeof code != 'number') {
+        return false;
+    }
+    var group = Math.floor(code / 1000);
+    return group == 3050 || group == 3090; //action_validate_exception and authorization_exception families
+}
+
+//Push a pending batch. done() is called when every request of the batch has its result.
+function flush(batchKey, done) {
+    done = done || (() => {});
+    var batch = pendingBatches[batchKey];
+    if (!batch) {
+        return done();
+    }
+    delete pendingBatches[batchKey];
+    clearTimeout(batch.timer);
+
+    if (batch.requests.length == 1) {
+        return pushTransaction(batch.eos, batch.requests[0].actions, (err, value) => {
+            batch.requests[0].callback(err, value);
+            done();
+        });
+    }
+
+    var actions = [];
+    batch.requests.forEach(r => actions.push(...r.actions));
+    console.log('PushBatch: ' + batch.requests.length + ' requests, ' + actions.length + ' actions');
+
+    pushTransaction(batch.eos, actions, (err, value) => {
+        if (!err) {
+            batch.requests.forEach(r => r.callback(null, value));
+            return done();
+        }
+        if (!isActionRejection(err)) {
+            console.log('BatchFailed, returning the error to ' + batch.requests.length + ' requests');
+            batch.requests.forEach(r => r.callback(err));
+            return done();
+        }
+        //A transaction is all or nothing, so one bad request would fail the whole batch.
+        //Retry each request on its own to give the others their own result.
+        console.log('BatchRejected, retrying ' + batch.requests.length + ' requests separately');
+        var left = batch.requests.length;
+        batch.requests.forEach(r => pushTransaction(batch.eos, r.actions, (err, value) => {
+            r.callback(err, value);
+            if (--left == 0) {
+                done();
+            }
+        }));
+    });
+}
+
+//Submit the actions of one relay request. callback(err, transactionResult)
+//clientKey identifies the eosjs client (endpoint/chain/key provider). Requests are only merged when all their
+//actions are authorized by the same single actor; pass actor = null to push immediately.
+function submit(eos, clientKey, actor, actions, callback) {
+    if (BATCH_WINDOW_MS <= 0) {
+        return pushTransaction(eos, actions, callback);
+    }
+
+    //A request pushed on its own must not overtake earlier requests of the same actor(s) still waiting in a
+    //batch, so those batches are pushed first and this request after they have their results
+    if (!actor || actions.length >= MAX_BATCH_ACTIONS) {
+        var batchKeys = Array.from(new Set(actions.map(a => clientKey + '|' + (a.authorization && a.authorization[0] ? a.authorization[0].actor : ''))))
+            .filter(key => pendingBatches[key]);
+        if (batchKeys.length == 0) {
+            return pushTransaction(eos, actions, callback);
+        }
+        var waiting = batchKeys.length;
+        batchKeys.forEach(key => flush(key, () => {
+            if (--waiting == 0) {
+                pushTransaction(eos, actions, callback);
+            }
+        }));
+        return;
+    }
+
+    var batchKey = clientKey + '|' + actor;
+    var batch = pendingBatches[batchKey];
+    if (batch && batch.actionCount + actions.length > MAX_BATCH_ACTIONS) {
+        flush(batchKey);
+        batch = null;
+    }
+
+    if (!batch) {
+        batch = { eos: eos, requests: [], actionCount: 0, timer: null };
+        batch.timer = setTimeout(() => flush(batchKey), BATCH_WINDOW_MS);
+        pendingBatches[batchKey] = batch;
+    }
+
+    batch.requests.push({ actions: actions, callback: callback });
+    batch.actionCount += actions.length;
+}
+
+module.exports = {
+    submit: submit,
+    isActionRejection: isActionRejection
+};
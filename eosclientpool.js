@@ -0,0 +1,160 @@
+// Long-lived eosjs clients, one per httpEndpoint/chainId/keyProvider.
+// Reusing a client keeps its ABI cache and its keep-alive HTTP connections to the node, and the
+// reference block used in transaction headers is cached so signing does not start with get_info/get_block.
+// The pool keeps at most EOS_CLIENT_POOL_SIZE clients (least recently used is evicted first) and drops clients
+// that have not been used for EOS_CLIENT_IDLE_MS. Evicted clients have their sockets closed.
+
+var http = require('http');
+var https = require('https');
+var crypto = require('crypto');
+var Eos = require('eosjs');
+
+var REFERENCE_BLOCK_MAX_AGE_MS = 10000; //A last irreversible block is valid as reference for much longer, but expiration is derived from it
+
+var POOL_SIZE = parseInt(process.env.EOS_CLIENT_POOL_SIZE || '32', 10);
+var IDLE_MS = parseInt(process.env.EOS_CLIENT_IDLE_MS || '300000', 10);
+
+var clients = new Map(); //client key -> entry, in least recently used order
+
+//Short fixed-size map key for endpoint, chain and key provider
+function getClientKey(httpEndpoint, chainId, keyProvider) {
+    return crypto.createHash('sha256')
+        .update(String(httpEndpoint) + '|' + String(chainId) + '|' + JSON.stringify(keyProvider))
+        .digest('hex');
+}
+
+function createAgent(httpEndpoint) {
+    var options = { keepAlive: true, maxSockets: 64 };
+    return String(httpEndpoint).indexOf('https:') == 0 ? new https.Agent(options) : new http.Agent(options);
+}
+
+function buildHeaders(referenceBlock, expireInSeconds) {
+    //Advance the cached chain time by the local time elapsed since it was fetched
+    var chainTime = Date.parse(referenceBlock.headBlockTime + 'Z') + (Date.now() - referenceBlock.fetchedAt);
+    var expiration = new Date(chainTime + expireInSeconds * 1000);
+
+    return {
+        expiration: expiration.toISOString().split('.')[0],
+        ref_block_num: referenceBlock.blockNum & 0xFFFF,
+        ref_block_prefix: referenceBlock.refBlockPrefix,
+        net_usage_words: 0,
+        max_cpu_usage_ms: 0,
+        delay_sec: 0,
+        context_free_actions: [],
+        actions: [],
+        signatures: [],
+        transaction_extensions: []
+    };
+}
+
+//transactionHeaders hook for eosjs. Concurrent callers share one get_info/get_block round trip.
+function createTransactionHeaders(entry) {
+    return function (expireInSeconds, callback) {
+        var referenceBlock = entry.referenceBlock;
+        if (referenceBlock && Date.now() - referenceBlock.fetchedAt < REFERENCE_BLOCK_MAX_AGE_MS) {
+            return callback(null, buildHeaders(referenceBlock, expireInSeconds));
+        }
+
+        entry.headerWaiters.push({ expireInSeconds: expireInSeconds, callback: callback });
+        if (entry.headerWaiters.length > 1) {
+            return; //Refresh already in flight
+        }
+
+        var fetchedAt = Date.now();
+        entry.eos.getInfo({}).then(info => {
+            return entry.eos.getBlock(info.last_irreversible_block_num).then(block => {
+                entry.referenceBlock = {
+                    blockNum: info.last_irreversible_block_num,
+                    refBlockPrefix: block.ref_block_prefix,
+                    headBlockTime: info.head_block_time,
+                    fetchedAt: fetchedAt
+                };
+            });
+        }).then(() => {
+            var waiters = entry.headerWaiters;
+            entry.headerWaiters = [];
+            waiters.forEach(w => w.callback(null, buildHeaders(entry.referenceBlock, w.expireInSeconds)));
+        }).catch(err => {
+            entry.referenceBlock = null;
+            var waiters = entry.headerWaiters;
+            entry.headerWaiters = [];
+            waiters.forEach(w => w.callback(err));
+        });
+    };
+}
+
+//Close the sockets of an evicted client once requests still running on them have finished
+function destroyAgentWhenIdle(agent) {
+    if (Object.keys(agent.sockets).length == 0 && Object.keys(agent.requests).length == 0) {
+        return agent.destroy();
+    }
+    setTimeout(() => destroyAgentWhenIdle(agent), 1000).unref();
+}
+
+function evict(key) {
+    var entry = clients.get(key);
+    clients.delete(key);
+    destroyAgentWhenIdle(entry.agent);
+}
+
+function evictIdle() {
+    var now = Date.now();
+    //Map iteration is in least recently used order, so stop at the first client that is still in use
+    for (var [key, entry] of clients) {
+        if (now - entry.lastUsed < IDLE_MS) {
+            break;
+        }
+        evict(key);
+    }
+}
+
+function getClient(httpEndpoint, chainId, keyProvider) {
+    var key = getClientKey(httpEndpoint, chainId, keyProvider);
+    var entry = clients.get(key);
+    if (entry) {
+        clients.delete(key); //Move to the most recently used end
+        clients.set(key, entry);
+        entry.lastUsed = Date.now();
+        return entry.eos;
+    }
+
+    entry = { eos: null, agent: createAgent(httpEndpoint), referenceBlock: null, headerWaiters: [], lastUsed: Date.now() };
+    entry.eos = Eos({
+        httpEndpoint: httpEndpoint,
+        chainId: chainId,
+        keyProvider: keyProvider,
+        expireInSeconds: 60,
+        verbose: false,
+        fetchConfiguration: { agent: entry.agent },
+        transactionHeaders: createTransactionHeaders(entry)
+    });
+    clients.set(key, entry);
+
+    while (clients.size > POOL_SIZE) {
+        evict(clients.keys().next().value);
+    }
+    return entry.eos;
+}
+
+//Forget the cached reference block, e.g. after a transaction was rejected as expired or for an unknown block
+function invalidateReferenceBlock(httpEndpoint, chainId, keyProvider) {
+    var entry = clients.get(getClientKey(httpEndpoint, chainId, keyProvider));
+    if (entry) {
+        entry.referenceBlock = null;
+    }
+}
+
+function size() {
+    return clients.size;
+}
+
+if (IDLE_MS > 0) {
+    setInterval(evictIdle, Math.min(IDLE_MS, 60000)).unref();
+}
+
+module.exports = {
+    getClientKey: getClientKey,
+    getClient: getClient,
+    invalidateReferenceBlock: invalidateReferenceBlock,
+    size: size
+};
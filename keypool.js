@@ -0,0 +1,247 @@
+// Pool of pre-generated keypairs for createNewAccount.
+// Ecc.randomKey() gathers entropy and is slow, so keys are generated in the background and a signup only
+// takes one from the pool. The pool is refilled to KEYPOOL_SIZE when it drops below KEYPOOL_LOW_WATER.
+// Ecc.randomKey() blocks the thread it runs on while it collects CPU entropy, so keys are generated in a
+// worker thread (this file, started with workerData.keyPoolWorker) and the relay's event loop keeps serving.
+//
+// Local test mode, no chain endpoint needed:
+//   node keypool.js --selftest [--fake]
+// --fake uses random bytes instead of eosjs-ecc, for machines without the eosjs packages installed.
+
+var crypto = require('crypto');
+var workerThreads = require('worker_threads');
+
+var DEFAULT_SIZE = parseInt(process.env.KEYPOOL_SIZE || '20', 10);
+var DEFAULT_LOW_WATER = parseInt(process.env.KEYPOOL_LOW_WATER || '5', 10);
+
+function generateEccKey() {
+    var Ecc = require('eosjs-ecc');
+    return Ecc.randomKey().then(privateKey => {
+        return { privateKey: privateKey, publicKey: Ecc.privateToPublic(privateKey) };
+    });
+}
+
+function generateFakeKey() {
+    var privateKey = crypto.randomBytes(32).toString('hex');
+    return Promise.resolve({ privateKey: privateKey, publicKey: 'FAKE' + crypto.createHash('sha256').update(privateKey).digest('hex') });
+}
+
+//Returns a generateKey function that runs generateEccKey (or generateFakeKey) in a worker thread.
+//The worker is started on first use and restarted if it dies.
+function createWorkerGenerator(fake) {
+    var worker = null;
+    var pending = new Map(); //request id -> { resolve, reject }
+    var nextId = 0;
+
+    var failPending = (err) => {
+        pending.forEach(p => p.reject(err));
+        pending.clear();
+        worker = null;
+    };
+
+    var startWorker = () => {
+        var w = new workerThreads.Worker(__filename, { workerData: { keyPoolWorker: true, fake: fake } });
+        worker = w;
+        w.on('message', msg => {
+            var p = pending.get(msg.id);
+            pending.delete(msg.id);
+            if (pending.size == 0) {
+                w.unref(); //An idle worker must not keep the process alive
+            }
+            if (p) {
+                msg.error ? p.reject(new Error(msg.error)) : p.resolve(msg.key);
+            }
+        });
+        //A crashed worker emits 'error' and then 'exit'. By then a new worker may have been started
+        //for new requests, so events of an old worker must not fail those.
+        w.on('error', err => {
+            if (worker === w) {
+                failPending(err);
+            }
+        });
+        w.on('exit', () => {
+            if (worker === w) {
+                failPending(new Error('Key generator worker exited'));
+            }
+        });
+    };
+
+    return function () {
+        if (!worker) {
+            startWorker();
+        }
+        worker.ref();
+        return new Promise((resolve, reject) => {
+            var id = nextId++;
+            pending.set(id, { resolve: resolve, reject: reject });
+            worker.postMessage({ id: id });
+        });
+    };
+}
+
+function runWorker(fake) {
+    var generate = fake ? generateFakeKey : generateEccKey;
+    workerThreads.parentPort.on('message', msg => {
+        generate().then(
+            key => workerThreads.parentPort.postMessage({ id: msg.id, key: key }),
+            err => workerThreads.parentPort.postMessage({ id: msg.id, error: err.message || String(err) }));
+    });
+}
+
+var defaultGenerator = null;
+
+function generateEccKeyInWorker() {
+    if (!defaultGenerator) {
+        defaultGenerator = createWorkerGenerator(false);
+    }
+    return defaultGenerator();
+}
+
+function KeyPool(options) {
+    options = options || {};
+    this.size = options.size || DEFAULT_SIZE;
+    this.lowWater = Math.min(options.lowWater || DEFAULT_LOW_WATER, this.size);
+    this.generateKey = options.generateKey || generateEccKeyInWorker;
+    this.keys = [];
+    this.refilling = false;
+    this.stats = { generated: 0, served: 0, misses: 0, refills: 0, errors: 0, lastGenerateMs: 0 };
+}
+
+KeyPool.prototype.generate = function () {
+    var startTime = Date.now();
+    return this.generateKey().then(key => {
+        this.stats.generated++;
+        this.stats.lastGenerateMs = Date.now() - startTime;
+        return key;
+    });
+};
+
+//Generate one key at a time until the pool is full, so refilling never competes with itself for entropy
+KeyPool.prototype.refill = function () {
+    if (this.refilling || this.keys.length >= this.size) {
+        return;
+    }
+    this.refilling = true;
+    this.stats.refills++;
+
+    var next = () => {
+        if (this.keys.length >= this.size) {
+            this.refilling = false;
+            return;
+        }
+        this.generate().then(key => {
+            this.keys.push(key);
+            setImmediate(next);
+        }).catch(err => {
+            console.error('KeyPoolRefillFailed');
+            console.error(err);
+            this.stats.errors++;
+            this.refilling = false;
+        });
+    };
+    next();
+};
+
+KeyPool.prototype.start = function () {
+    this.refill();
+    return this;
+};
+
+//Resolves to { privateKey, publicKey }. Falls back to generating inline when the pool is empty.
+KeyPool.prototype.take = function () {
+    var key = this.keys.shift();
+    if (this.keys.length < this.lowWater) {
+        this.refill();
+    }
+
+    if (key) {
+        this.stats.served++;
+        return Promise.resolve(key);
+    }
+
+    this.stats.misses++;
+    return this.generate().then(key => {
+        this.stats.served++;
+        return key;
+    });
+};
+
+KeyPool.prototype.metrics = function () {
+    return {
+        depth: this.keys.length,
+        size: this.size,
+        lowWater: this.lowWater,
+        refilling: this.refilling,
+        generated: this.stats.generated,
+        served: this.stats.served,
+        misses: this.stats.misses,
+        refills: this.stats.refills,
+        errors: this.stats.errors,
+        lastGenerateMs: this.stats.lastGenerateMs
+    };
+};
+
+function selfTest(fake) {
+    var pool = new KeyPool({ size: 10, lowWater: 3, generateKey: fake ? createWorkerGenerator(true) : generateEccKeyInWorker }).start();
+
+    //The event loop must stay responsive while keys are generated
+    var loopDelay = require('perf_hooks').monitorEventLoopDelay({ resolution: 10 });
+    loopDelay.enable();
+
+    var waitUntilFull = (callback) => {
+        if (pool.keys.length >= pool.size && !pool.refilling) {
+            return callback();
+        }
+        setTimeout(() => waitUntilFull(callback), 10);
+    };
+
+    waitUntilFull(() => {
+        console.log('Filled: ' + JSON.stringify(pool.metrics()));
+
+        //Signup burst larger than the pool
+        var startTime = Date.now();
+        var burst = [];
+        for (var i = 0; i < 15; i++) {
+            burst.push(pool.take());
+        }
+        Promise.all(burst).then(keys => {
+            var unique = new Set(keys.map(k => k.privateKey)).size;
+            console.log('Burst of ' + keys.length + ' keys (' + unique + ' unique) in ' + (Date.now() - startTime) + ' ms: ' + JSON.stringify(pool.metrics()));
+            if (unique != keys.length) {
+                console.error('SelfTestFailed: duplicate keys served');
+                process.exit(1);
+            }
+
+            waitUntilFull(() => {
+                console.log('Refilled: ' + JSON.stringify(pool.metrics()));
+                console.log('Max event loop delay: ' + (loopDelay.max / 1e6).toFixed(1) + ' ms');
+                console.log('SelfTestOk');
+            });
+        }).catch(err => {
+            console.error('SelfTestFailed');
+            console.error(err);
+            process.exit(1);
+        });
+    });
+}
+
+var defaultPool = null;
+
+module.exports = {
+    KeyPool: KeyPool,
+    generateFakeKey: generateFakeKey,
+    createWorkerGenerator: createWorkerGenerator,
+    getDefaultPool: function () {
+        if (!defaultPool) {
+            defaultPool = new KeyPool().start();
+        }
+        return defaultPool;
+    }
+};
+
+if (!workerThreads.isMainThread && workerThreads.workerData && workerThreads.workerData.keyPoolWorker) {
+    runWorker(workerThreads.workerData.fake);
+}
+else if (require.main === module && process.argv.indexOf('--selftest') >= 0) {
+    selfTest(process.argv.indexOf('--fake') >= 0);
+}
@@ -0,0 +1,79 @@
+// Latency histograms per request type, reported by the relay on GET /metrics
+
+var BUCKETS_MS = [5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000];
+
+var histograms = {};
+
+function LatencyHistogram() {
+    this.counts = new Array(BUCKETS_MS.length + 1).fill(0); //Last bucket is everything above 30 seconds
+    this.count = 0;
+    this.sumMs = 0;
+    this.maxMs = 0;
+}
+
+LatencyHistogram.prototype.record = function (ms) {
+    var i = 0;
+    while (i < BUCKETS_MS.length && ms > BUCKETS_MS[i]) {
+        i++;
+    }
+    this.counts[i]++;
+    this.count++;
+    this.sumMs += ms;
+    if (ms > this.maxMs) {
+        this.maxMs = ms;
+    }
+};
+
+//Upper bound of the bucket that holds the given percentile (0-100)
+LatencyHistogram.prototype.percentile = function (p) {
+    if (this.count == 0) {
+        return 0;
+    }
+    var rank = Math.ceil(this.count * p / 100);
+    var seen = 0;
+    for (var i = 0; i < this.counts.length; i++) {
+        seen += this.counts[i];
+        if (seen >= rank) {
+            return i < BUCKETS_MS.length ? Math.min(BUCKETS_MS[i], this.maxMs) : this.maxMs;
+        }
+    }
+    return this.maxMs;
+};
+
+LatencyHistogram.prototype.toJSON = function () {
+    var buckets = {};
+    for (var i = 0; i < BUCKETS_MS.length; i++) {
+        buckets['le' + BUCKETS_MS[i]] = this.counts[i];
+    }
+    buckets['inf'] = this.counts[BUCKETS_MS.length];
+
+    return {
+        count: this.count,
+        meanMs: this.count > 0 ? Math.round(this.sumMs / this.count) : 0,
+        p50Ms: this.percentile(50),
+        p99Ms: this.percentile(99),
+        maxMs: this.maxMs,
+        buckets: buckets
+    };
+};
+
+function record(requestType, ms) {
+    if (!histograms[requestType]) {
+        histograms[requestType] = new LatencyHistogram();
+    }
+    histograms[requestType].record(ms);
+}
+
+function snapshot() {
+    var result = {};
+    Object.keys(histograms).forEach(requestType => {
+        result[requestType] = histograms[requestType].toJSON();
+    });
+    return result;
+}
+
+module.exports = {
+    LatencyHistogram: LatencyHistogram,
+    record: record,
+    snapshot: snapshot
+};
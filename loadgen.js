@@ -0,0 +1,281 @@
+// Load generator and latency benchmark for the server.js relay.
+// Replays a mix of createNewAccount, createNewAccountWithPublicKey and generic action requests against the relay,
+// with mocknode.js standing in for the chain, and reports throughput and p50/p99 latency per request type.
+// requestsPerSec counts every answered request, okPerSec only those that returned a transaction id. Latencies are
+// of the successful requests.
+//
+//   node loadgen.js --spawn              starts mocknode.js and server.js on the ports below, runs, stops them
+//   node loadgen.js                      uses a relay and node that are already running
+//
+// LOADGEN_RELAY        relay url (http://127.0.0.1:3000)
+// LOADGEN_NODE         chain url the relay should use (http://127.0.0.1:8888)
+// LOADGEN_REQUESTS     total requests (1000)
+// LOADGEN_CONCURRENCY  requests in flight (16)
+// LOADGEN_MIX          weights per request type (createNewAccount:1,createNewAccountWithPublicKey:2,runActions:7)
+// Chain latency is set on the mock node with MOCK_LATENCY_MS, MOCK_PUSH_LATENCY_MS and MOCK_JITTER_MS.
+
+var http = require('http');
+var url = require('url');
+var path = require('path');
+var childProcess = require('child_process');
+var tableRows = require('./tablerows');
+
+var RELAY = process.env.LOADGEN_RELAY || 'http://127.0.0.1:3000';
+var NODE = process.env.LOADGEN_NODE || 'http://127.0.0.1:8888';
+var REQUESTS = parseInt(process.env.LOADGEN_REQUESTS || '1000', 10);
+var CONCURRENCY = parseInt(process.env.LOADGEN_CONCURRENCY || '16', 10);
+var MIX = process.env.LOADGEN_MIX || 'createNewAccount:1,createNewAccountWithPublicKey:2,runActions:7';
+var CHAIN_ID = process.env.MOCK_CHAIN_ID || 'cf057bbfb72640471fd910bcb67639c22df9f92470936cddc1ade0e2f2e7dc4f';
+
+//Well known EOSIO development keypair. The mock node does not verify signatures.
+var DEV_PRIVATE_KEY = '5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3';
+var DEV_PUBLIC_KEY = 'EOS6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV';
+
+var ACTORS = ['alice', 'bob', 'carol', 'dave', 'erin', 'frank', 'grace', 'heidi'];
+
+var relayUrl = url.parse(RELAY);
+var agent = new http.Agent({ keepAlive: true, maxSockets: CONCURRENCY });
+var accountCounter = 0;
+
+function parseMix(mix) {
+    var weights = [];
+    mix.split(',').forEach(part => {
+        var pair = part.split(':');
+        weights.push({ type: pair[0].trim(), weight: parseFloat(pair[1] || '1') });
+    });
+    return weights;
+}
+
+function pickType(weights) {
+    var total = weights.reduce((sum, w) => sum + w.weight, 0);
+    var r = Math.random() * total;
+    for (var i = 0; i < weights.length; i++) {
+        r -= weights[i].weight;
+        if (r < 0) {
+            return weights[i].type;
+        }
+    }
+    return weights[weights.length - 1].type;
+}
+
+//Unique 12 character account names: 'bench' + 7 letters
+function nextAccountName() {
+    var n = accountCounter++;
+    var suffix = '';
+    for (var i = 0; i < 7; i++) {
+        suffix = String.fromCharCode(97 + (n % 26)) + suffix;
+        n = Math.floor(n / 26);
+    }
+    return 'bench' + suffix;
+}
+
+function serializeName(name) {
+    var buffer = Buffer.alloc(8);
+    buffer.writeBigUInt64LE(tableRows.nameToUint64(name));
+    return buffer;
+}
+
+function serializeString(str) {
+    var bytes = Buffer.from(str, 'utf8');
+    var length = [];
+    var n = bytes.length;
+    do {
+        length.push((n & 0x7f) | (n > 0x7f ? 0x80 : 0));
+        n >>>= 7;
+    } while (n > 0);
+    return Buffer.concat([Buffer.from(length), bytes]);
+}
+
+function buildRequest(type) {
+    var request = {
+        description: type,
+        httpEndpoint: NODE,
+        chainId: CHAIN_ID,
+        keyProvider: [DEV_PRIVATE_KEY]
+    };
+
+    if (type == 'createNewAccount' || type == 'createNewAccountWithPublicKey') {
+        request.newAccountName = nextAccountName();
+        request.stakeNetQuantity = '0.1000 EOS';
+        request.stakeCpuQuantity = '0.1000 EOS';
+        request.transferEOSAmount = '0.1000 EOS';
+        if (type == 'createNewAccountWithPublicKey') {
+            request.publicKey = DEV_PUBLIC_KEY;
+        }
+        return request;
+    }
+
+    //Generic actions: an upsertcrew from a random crew member
+    var actor = ACTORS[Math.floor(Math.random() * ACTORS.length)];
+    var binArgs = Buffer.concat([serializeName(actor), serializeName(actor), serializeString(''), serializeString('Arr! ' + Date.now())]);
+    request.transactions = [{ account: 'cptblackbill', actionName: 'upsertcrew', actor: actor, binArgs: binArgs.toString('hex') }];
+    return request;
+}
+
+function sendRequest(body) {
+    return new Promise(resolve => {
+        var startTime = process.hrtime.bigint();
+        var done = (ok, error) => resolve({ ok: ok, error: error, ms: Number(process.hrtime.bigint() - startTime) / 1e6 });
+
+        var request = http.request({
+            hostname: relayUrl.hostname,
+            port: relayUrl.port,
+            path: '/',
+            method: 'POST',
+            agent: agent,
+            headers: { 'Content-Type': 'application/json' }
+        }, (response) => {
+            let chunks = [];
+            response.on('data', chunk => chunks.push(chunk));
+            response.on('end', () => {
+                try {
+                    var result = JSON.parse(Buffer.concat(chunks).toString());
+                    var transaction = result.transactions && result.transactions[0];
+                    if (transaction && transaction.eostransid) {
+                        return done(true);
+                    }
+                    done(false, transaction ? transaction.status : result.Error);
+                } catch (e) {
+                    done(false, e.message);
+                }
+            });
+        });
+        request.on('error', err => done(false, err.message));
+        request.end(JSON.stringify(body));
+    });
+}
+
+function percentile(sorted, p) {
+    if (sorted.length == 0) {
+        return 0;
+    }
+    return sorted[Math.min(sorted.length - 1, Math.ceil(sorted.length * p / 100) - 1)];
+}
+
+function summarize(samples, seconds) {
+    var latencies = samples.filter(s => s.ok).map(s => s.ms).sort((a, b) => a - b);
+    return {
+        requests: samples.length,
+        ok: latencies.length,
+        failed: samples.length - latencies.length,
+        requestsPerSec: +(samples.length / seconds).toFixed(1),
+        okPerSec: +(latencies.length / seconds).toFixed(1),
+        p50Ms: +percentile(latencies, 50).toFixed(1),
+        p99Ms: +percentile(latencies, 99).toFixed(1),
+        maxMs: +(latencies.length ? latencies[latencies.length - 1] : 0).toFixed(1)
+    };
+}
+
+function run() {
+    var weights = parseMix(MIX);
+    var samples = [];
+    var errors = {};
+    var started = 0;
+    var startTime = Date.now();
+
+    return new Promise(resolve => {
+        var worker = () => {
+            if (started >= REQUESTS) {
+                return Promise.resolve();
+            }
+            started++;
+            var type = pickType(weights);
+            return sendRequest(buildRequest(type)).then(result => {
+                result.type = type;
+                samples.push(result);
+                if (!result.ok) {
+                    errors[result.error] = (errors[result.error] || 0) + 1;
+                }
+                return worker();
+            });
+        };
+
+        var workers = [];
+        for (var i = 0; i < CONCURRENCY; i++) {
+            workers.push(worker());
+        }
+        Promise.all(workers).then(() => {
+            var seconds = (Date.now() - startTime) / 1000;
+            var report = { seconds: seconds, concurrency: CONCURRENCY, total: summarize(samples, seconds), byType: {}, errors: errors };
+            weights.forEach(w => {
+                report.byType[w.type] = summarize(samples.filter(s => s.type == w.type), seconds);
+            });
+            resolve(report);
+        });
+    });
+}
+
+function waitForPort(target, urlPath, retries) {
+    return new Promise((resolve, reject) => {
+        var parsed = url.parse(target);
+        var attempt = (left) => {
+            var request = http.get({ hostname: parsed.hostname, port: parsed.port, path: urlPath }, response => {
+                response.resume();
+                resolve();
+            });
+            request.on('error', () => {
+                if (left <= 0) {
+                    return reject(new Error('Nothing listening on ' + target));
+                }
+                setTimeout(() => attempt(left - 1), 100);
+            });
+        };
+        attempt(retries);
+    });
+}
+
+function getJson(target, urlPath) {
+    return new Promise(resolve => {
+        var parsed = url.parse(target);
+        http.get({ hostname: parsed.hostname, port: parsed.port, path: urlPath }, response => {
+            let chunks = [];
+            response.on('data', chunk => chunks.push(chunk));
+            response.on('end', () => {
+                try {
+                    resolve(JSON.parse(Buffer.concat(chunks).toString()));
+                } catch (e) {
+                    resolve(null);
+                }
+            });
+        }).on('error', () => resolve(null));
+    });
+}
+
+function spawn(script, env) {
+    var child = childProcess.spawn(process.execPath, [path.join(__dirname, script)], {
+        env: Object.assign({}, process.env, env),
+        stdio: ['ignore', 'ignore', 'inherit']
+    });
+    return child;
+}
+
+function main() {
+    var children = [];
+    var ready = Promise.resolve();
+
+    if (process.argv.indexOf('--spawn') >= 0) {
+        children.push(spawn('mocknode.js', { MOCK_PORT: url.parse(NODE).port }));
+        children.push(spawn('server.js', { RELAY_PORT: relayUrl.port }));
+        ready = Promise.all([waitForPort(NODE, '/v1/mock/stats', 50), waitForPort(RELAY, '/metrics', 50)]);
+    }
+
+    ready.then(run).then(report => {
+        return Promise.all([getJson(RELAY, '/metrics'), getJson(NODE, '/v1/mock/stats')]).then(extra => {
+            report.relayMetrics = extra[0];
+            report.nodeStats = extra[1];
+            return report;
+        });
+    }).then(report => {
+        console.log(JSON.stringify(report, null, 2));
+    }).catch(err => {
+        console.error(err.message);
+        process.exitCode = 1;
+    }).then(() => {
+        children.forEach(child => child.kill());
+        agent.destroy();
+    });
+}
+
+if (require.main === module) {
+    main();
+}
@@ -0,0 +1,48 @@
+// Minimal ABIs served by mocknode.js for the actions the relay pushes
+
+function abi(structs, actions) {
+    return {
+        version: 'eosio::abi/1.0',
+        types: [{ new_type_name: 'account_name', type: 'name' }],
+        structs: structs,
+        actions: actions.map(a => ({ name: a, type: a, ricardian_contract: '' })),
+        tables: [],
+        ricardian_clauses: [],
+        abi_extensions: []
+    };
+}
+
+function struct(name, fields) {
+    return {
+        name: name,
+        base: '',
+        fields: Object.keys(fields).map(f => ({ name: f, type: fields[f] }))
+    };
+}
+
+var ABIS = {
+    'eosio': abi([
+        struct('permission_level', { actor: 'name', permission: 'name' }),
+        struct('key_weight', { key: 'public_key', weight: 'uint16' }),
+        struct('permission_level_weight', { permission: 'permission_level', weight: 'uint16' }),
+        struct('wait_weight', { wait_sec: 'uint32', weight: 'uint16' }),
+        struct('authority', { threshold: 'uint32', keys: 'key_weight[]', accounts: 'permission_level_weight[]', waits: 'wait_weight[]' }),
+        struct('newaccount', { creator: 'name', name: 'name', owner: 'authority', active: 'authority' }),
+        struct('buyrambytes', { payer: 'name', receiver: 'name', bytes: 'uint32' }),
+        struct('delegatebw', { from: 'name', receiver: 'name', stake_net_quantity: 'asset', stake_cpu_quantity: 'asset', transfer: 'bool' })
+    ], ['newaccount', 'buyrambytes', 'delegatebw']),
+
+    'eosio.token': abi([
+        struct('transfer', { from: 'name', to: 'name', quantity: 'asset', memo: 'string' })
+    ], ['transfer']),
+
+    'cptblackbill': abi([
+        struct('addtreasure', { owner: 'name', title: 'string', imageurl: 'string', latitude: 'float64', longitude: 'float64' }),
+        struct('modtreasure', { user: 'name', pkey: 'uint64', title: 'string', description: 'string', imageurl: 'string', videourl: 'string' }),
+        struct('erasetreasur', { user: 'name', pkey: 'uint64' }),
+        struct('upsertcrew', { user: 'name', crewmember: 'name', imagehash: 'string', quote: 'string' }),
+        struct('erasecrew', { user: 'name' })
+    ], ['addtreasure', 'modtreasure', 'erasetreasur', 'upsertcrew', 'erasecrew'])
+};
+
+module.exports = ABIS;
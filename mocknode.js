@@ -0,0 +1,321 @@
+// Local stand-in for a chain node with generated cptblackbill tables.
+// Serves the chain API used by server.js (get_info, get_block, get_abi, get_code, get_required_keys, push_transaction),
+// get_table_rows and the history plugin's get_actions, so the relay and tablecache.js can be tested without a network.
+//
+//   MOCK_PORT=8888 MOCK_TREASURES=1000 MOCK_RESULTS=1000 MOCK_LATENCY_MS=20 node mocknode.js
+//
+// MOCK_LATENCY_MS (+ up to MOCK_JITTER_MS) delays every response. push_transaction is delayed by MOCK_PUSH_LATENCY_MS
+// instead, and rejects a share MOCK_FAIL_RATE (0-1) of the transactions. Transactions are accepted without checking
+// signatures and do not change the tables, but every action must exist in the ABI mockabis.js has for its account.
+// POST /v1/mock/push_action { name, data } applies a cptblackbill action to the tables and appends it to the
+// action history. GET /v1/mock/stats returns how many requests reached the node.
+
+var http = require('http');
+var crypto = require('crypto');
+var tableRows = require('./tablerows');
+var mockAbis = require('./mockabis');
+
+var CODE = 'cptblackbill';
+var PORT = parseInt(process.env.MOCK_PORT || '8888', 10);
+var TREASURE_COUNT = parseInt(process.env.MOCK_TREASURES || '1000', 10);
+var RESULT_COUNT = parseInt(process.env.MOCK_RESULTS || '1000', 10);
+var CHAIN_ID = process.env.MOCK_CHAIN_ID || 'cf057bbfb72640471fd910bcb67639c22df9f92470936cddc1ade0e2f2e7dc4f';
+var LATENCY_MS = parseInt(process.env.MOCK_LATENCY_MS || '0', 10);
+var JITTER_MS = parseInt(process.env.MOCK_JITTER_MS || '0', 10);
+var PUSH_LATENCY_MS = parseInt(process.env.MOCK_PUSH_LATENCY_MS || String(LATENCY_MS), 10);
+var FAIL_RATE = parseFloat(process.env.MOCK_FAIL_RATE || '0');
+var BLOCK_INTERVAL_MS = 500;
+var START_TIME = Date.now();
+
+var ACCOUNTS = ['alice', 'bob', 'carol', 'dave', 'erin', 'frank', 'grace', 'heidi'];
+
+var tables = {};
+var history = [];
+var stats = {};
+var pushed = { transactions: 0, actions: 0, failed: 0 };
+
+function countRequest(path) {
+    stats[path] = (stats[path] || 0) + 1;
+}
+
+function now() {
+    return Math.floor(Date.now() / 1000);
+}
+
+function seedTables() {
+    Object.keys(tableRows.TABLES).forEach(table => {
+        tables[table] = new tableRows.TableStore(table);
+    });
+
+    for (var i = 0; i < TREASURE_COUNT; i++) {
+        tables.treasure.upsert({
+            pkey: i,
+            owner: ACCOUNTS[i % ACCOUNTS.length],
+            title: 'Treasure ' + i,
+            description: '',
+            imageurl: '',
+            treasuremapurl: '',
+            videourl: '',
+            latitude: ((i * 37) % 170) - 85 + 0.5,
+            longitude: ((i * 53) % 350) - 175 + 0.5,
+            prechesttransfer: '0.0000 EOS',
+            rankingpoint: (i * 7919) % 10000,
+            timestamp: now(),
+            expirationdate: now() + 94608000,
+            status: '',
+            jsondata: ''
+        });
+    }
+
+    for (var j = 0; j < RESULT_COUNT; j++) {
+        tables.results.upsert({
+            pkey: j,
+            treasurepkey: j % Math.max(TREASURE_COUNT, 1),
+            user: ACCOUNTS[(j + 1) % ACCOUNTS.length],
+            creator: ACCOUNTS[j % ACCOUNTS.length],
+            trxid: '',
+            payouteos: '1.0000 EOS',
+            eosusdprice: '2.7600 USD',
+            minedblkbills: '10.0000 BLKBILL',
+            timestamp: now()
+        });
+    }
+
+    tables.settings.upsert({ keyname: 'eosusd', stringvalue: '', assetvalue: '2.7600 USD', uintvalue: 0, timestamp: now() });
+    tables.settings.upsert({ keyname: 'checktreasur', stringvalue: '', assetvalue: '2.0000 USD', uintvalue: 0, timestamp: now() });
+
+    ACCOUNTS.forEach(account => {
+        tables.crewinfo.upsert({ user: account, imagehash: '', quote: 'Arr!' });
+    });
+}
+
+function findRow(table, key) {
+    return tables[table].query({ lower_bound: key, upper_bound: key, limit: 1 }).rows[0];
+}
+
+//Applies the table effects of the cptblackbill actions that tablecache.js tracks
+function applyAction(name, data) {
+    switch (name) {
+        case 'addtreasure':
+            tables.treasure.upsert({
+                pkey: Number(tables.treasure.maxPrimaryKey() + 1n), owner: data.owner, title: data.title, description: '',
+                imageurl: data.imageurl, treasuremapurl: '', videourl: '', latitude: data.latitude, longitude: data.longitude,
+                prechesttransfer: '0.0000 EOS', rankingpoint: 0, timestamp: now(), expirationdate: now() + 94608000, status: '', jsondata: ''
+            });
+            break;
+        case 'modtreasure':
+            var treasure = findRow('treasure', data.pkey);
+            if (treasure) {
+                tables.treasure.upsert(Object.assign({}, treasure, { title: data.title, description: data.description, imageurl: data.imageurl, videourl: data.videourl }));
+            }
+            break;
+        case 'erasetreasur':
+            tables.treasure.remove(data.pkey);
+            break;
+        case 'addsetting':
+        case 'modsetting':
+            tables.settings.upsert({ keyname: data.keyname, stringvalue: data.stringvalue, assetvalue: data.assetvalue, uintvalue: data.uintvalue, timestamp: now() });
+            break;
+        case 'erasesetting':
+            tables.settings.remove(tableRows.nameToUint64(data.keyname));
+            break;
+        case 'upsertcrew':
+            tables.crewinfo.upsert({ user: data.crewmember, imagehash: data.imagehash, quote: data.quote });
+            break;
+        case 'erasecrew':
+            tables.crewinfo.remove(tableRows.nameToUint64(data.user));
+            break;
+        case 'eraseresult':
+            tables.results.remove(data.pkey);
+            break;
+        default:
+            throw new Error('Mock node does not implement action ' + name);
+    }
+
+    history.push({
+        global_action_seq: history.length + 1,
+        account_action_seq: history.length,
+        block_num: history.length + 1,
+        block_time: new Date().toISOString().split('.')[0],
+        action_trace: { act: { account: CODE, name: name, authorization: [], data: data } }
+    });
+}
+
+//Same pos/offset semantics as the history plugin: pos -1 is the latest action, offset is relative to pos
+function getActions(params) {
+    var last = history.length - 1;
+    var pos = (params.pos === undefined || params.pos < 0) ? last : params.pos;
+    var offset = params.offset === undefined ? -20 : params.offset;
+    var first = Math.max(Math.min(pos, pos + offset), 0);
+    var end = Math.min(Math.max(pos, pos + offset), last);
+    return { actions: history.slice(first, end + 1), last_irreversible_block: history.length };
+}
+
+function headBlockNum() {
+    return Math.floor((Date.now() - START_TIME) / BLOCK_INTERVAL_MS) + 1000;
+}
+
+function blockTime(blockNum) {
+    return new Date(START_TIME + (blockNum - 1000) * BLOCK_INTERVAL_MS).toISOString().replace('Z', '').substr(0, 23);
+}
+
+function blockId(blockNum) {
+    //Block ids start with the block number, like on chain
+    var hash = crypto.createHash('sha256').update(String(blockNum)).digest('hex');
+    return ('00000000' + blockNum.toString(16)).slice(-8) + hash.substr(8);
+}
+
+function getInfo() {
+    var head = headBlockNum();
+    return {
+        server_version: 'mocknode',
+        chain_id: CHAIN_ID,
+        head_block_num: head,
+        last_irreversible_block_num: head - 3,
+        last_irreversible_block_id: blockId(head - 3),
+        head_block_id: blockId(head),
+        head_block_time: blockTime(head),
+        head_block_producer: 'eosio',
+        virtual_block_cpu_limit: 200000000,
+        virtual_block_net_limit: 1048576000,
+        block_cpu_limit: 199900,
+        block_net_limit: 1048576
+    };
+}
+
+function getBlock(params) {
+    var blockNum = parseInt(params.block_num_or_id, 10);
+    var id = blockId(blockNum);
+    return {
+        block_num: blockNum,
+        id: id,
+        timestamp: blockTime(blockNum),
+        producer: 'eosio',
+        ref_block_prefix: Buffer.from(id, 'hex').readUInt32LE(8),
+        transactions: []
+    };
+}
+
+function getAbi(params) {
+    var abi = mockAbis[params.account_name];
+    if (!abi) {
+        throw new Error('Unknown account ' + params.account_name);
+    }
+    return { account_name: params.account_name, abi: abi };
+}
+
+//Error with the chain error body a node returns, e.g. { code: 3050003, name: 'eosio_assert_message_exception' }
+function chainError(code, name, what) {
+    var err = new Error(what);
+    err.chainError = { code: code, name: name, what: what, details: [] };
+    return err;
+}
+
+function checkActions(actions) {
+    (actions || []).forEach(a => {
+        var abi = mockAbis[a.account];
+        if (!abi || !abi.actions.some(action => action.name == a.name)) {
+            throw chainError(3015014, 'pack_exception', 'Unknown action ' + a.name + ' in contract ' + a.account);
+        }
+    });
+}
+
+function pushTransaction(params) {
+    checkActions(params.transaction && params.transaction.actions);
+    if (Math.random() < FAIL_RATE) {
+        pushed.failed++;
+        throw new Error('Mock transaction failure');
+    }
+    pushed.transactions++;
+    pushed.actions += (params.transaction && params.transaction.actions) ? params.transaction.actions.length : 1;
+
+    var id = crypto.createHash('sha256').update(JSON.stringify(params) + pushed.transactions).digest('hex');
+    return {
+        transaction_id: id,
+        processed: {
+            id: id,
+            block_num: headBlockNum() + 1,
+            receipt: { status: 'executed', cpu_usage_us: 300, net_usage_words: 16 },
+            elapsed: 300,
+            net_usage: 128,
+            scheduled: false,
+            action_traces: [],
+            except: null
+        }
+    };
+}
+
+function handle(path, params) {
+    switch (path) {
+        case '/v1/chain/get_info':
+            return getInfo();
+        case '/v1/chain/get_block':
+            return getBlock(params);
+        case '/v1/chain/get_abi':
+            return getAbi(params);
+        case '/v1/chain/get_code':
+            return Object.assign({ code_hash: '', wast: '', wasm: '' }, getAbi(params));
+        case '/v1/chain/get_required_keys':
+            return { required_keys: params.available_keys || [] };
+        case '/v1/chain/push_transaction':
+            return pushTransaction(params);
+        case '/v1/chain/get_table_rows':
+            if (params.code != CODE || !tables[params.table]) {
+                return { rows: [], more: false };
+            }
+            return tables[params.table].query(params);
+        case '/v1/history/get_actions':
+            return getActions(params);
+        case '/v1/mock/push_action':
+            applyAction(params.name, params.data);
+            return { account_action_seq: history.length - 1 };
+        case '/v1/mock/stats':
+            return { requests: stats, pushed: pushed, tables: Object.keys(tables).reduce((r, t) => { r[t] = tables[t].rows.size; return r; }, {}) };
+        default:
+            return null;
+    }
+}
+
+function createServer() {
+    return http.createServer((request, response) => {
+        let body = [];
+        request.on('data', (chunk) => {
+            body.push(chunk);
+        }).on('end', () => {
+            var path = request.url.split('?')[0];
+            countRequest(path);
+
+            var statusCode = 200;
+            var result;
+            try {
+                var text = Buffer.concat(body).toString();
+                result = handle(path, text ? JSON.parse(text) : {});
+                if (result === null) {
+                    statusCode = 404;
+                    result = { code: 404, message: 'Not Found' };
+                }
+            } catch (e) {
+                statusCode = 500;
+                result = { code: 500, message: e.message, error: e.chainError || { what: e.message, details: [] } };
+            }
+
+            var delay = (path == '/v1/chain/push_transaction' ? PUSH_LATENCY_MS : LATENCY_MS) + Math.floor(Math.random() * (JITTER_MS + 1));
+            setTimeout(() => {
+                response.writeHead(statusCode, { 'Content-Type': 'application/json' })
+                response.end(JSON.stringify(result));
+            }, delay);
+        });
+    });
+}
+
+seedTables();
+
+module.exports = {
+    createServer: createServer,
+    handle: handle
+};
+
+if (require.main === module) {
+    createServer().listen(PORT);
+    console.log('Mock node listening on ' + PORT + ' with ' + TREASURE_COUNT + ' treasures');
+}
@@ -1,11 +1,35 @@
 var http = require('http');
 var express = require('express');
+var eosClientPool = require('./eosclientpool');
+var actionBatcher = require('./actionbatcher');
+var keyPool = require('./keypool').getDefaultPool(); //Starts generating keys for createNewAccount right away
+var tableCache = require('./tablecache');
+
+var CACHE_INVALIDATE_URL = process.env.CACHE_INVALIDATE_URL; //Table cache (tablecache.js) to notify about pushed actions, e.g. http://127.0.0.1:3001
+var latencyHistogram = require('./latencyhistogram');
+var MAX_BODY_BYTES = parseInt(process.env.RELAY_MAX_BODY_BYTES || '65536', 10); //Larger request bodies are refused without reading the rest
+
+function sendResponse(response, requestType, startTime, returndata) {
+    latencyHistogram.record(requestType, Date.now() - startTime);
+    response.writeHead(200, { 'Content-Type': 'application/json' })
+    response.write(JSON.stringify(returndata));
+    response.end();
+}
 
 http.createServer((request, response) => {
 
     const { headers, method, url } = request;
     let body = [];
+    let bodyBytes = 0;
     var transactionReturn = "";
+    var startTime = Date.now();
+
+    if (method == 'GET' && url == '/metrics') {
+        response.writeHead(200, { 'Content-Type': 'application/json' })
+        response.write(JSON.stringify({ clients: eosClientPool.size(), keyPool: keyPool.metrics(), latency: latencyHistogram.snapshot() }));
+        response.end();
+        return;
+    }
 
     request.on('error', (err) => {
 
@@ -14,27 +38,61 @@ http.createServer((request, response) => {
         response.write(JSON.stringify(transactionReturn));
         response.end();
 
-    }).on('data', (jsonData) => {
-        var jsonContent = JSON.parse(jsonData);
+    }).on('data', (chunk) => {
+        bodyBytes += chunk.length;
+        if (bodyBytes > MAX_BODY_BYTES) {
+            console.log('RequestBodyTooLarge');
+            request.pause();
+            request.removeAllListeners('data');
+            request.removeAllListeners('end');
+            body = [];
+            response.setHeader('Connection', 'close');
+            sendResponse(response, 'invalidRequest', startTime, { 'Error': 'Request body is larger than ' + MAX_BODY_BYTES + ' bytes' });
+            return;
+        }
+        body.push(chunk); //Request body can arrive in several chunks. Parse it when complete.
+
+    }).on('end', () => {
+        console.log('No more data received.');
+
+        response.on('error', (err) => {
+            console.error('Error in end-function');
+            console.error(err);
+        });
+
+        var jsonContent;
+        try {
+            jsonContent = JSON.parse(Buffer.concat(body).toString());
+        } catch (e) {
+            console.log('InvalidRequestBody');
+            sendResponse(response, 'invalidRequest', startTime, { 'Error': 'Request body is not valid JSON: ' + e.message });
+            return;
+        }
+        if (jsonContent === null || typeof jsonContent != 'object' || Array.isArray(jsonContent)) {
+            console.log('InvalidRequestBody');
+            sendResponse(response, 'invalidRequest', startTime, { 'Error': 'Request body must be a JSON object' });
+            return;
+        }
         console.log('Received data');
         console.log(jsonContent);
         var returndata = { transactions: [] }; //To use as return value
 
-        Eos = require('eosjs');
-        eos = Eos({
-            httpEndpoint: jsonContent.httpEndpoint,
-            chainId: jsonContent.chainId,
-            keyProvider: jsonContent.keyProvider,
-            expireInSeconds: 60,
-            verbose: false
-        });
+        var eos = eosClientPool.getClient(jsonContent.httpEndpoint, jsonContent.chainId, jsonContent.keyProvider);
+        var requestType = jsonContent.description == 'createNewAccount' || jsonContent.description == 'createNewAccountWithPublicKey' ? jsonContent.description : 'runActions';
+        var transactionFailed = function (e) {
+            console.log('TransactionFailed');
+            console.log(e);
+            eosClientPool.invalidateReferenceBlock(jsonContent.httpEndpoint, jsonContent.chainId, jsonContent.keyProvider);
+            returndata.transactions.push({ transno: "1", eostransid: '', status: e.message || String(e) });
+            sendResponse(response, requestType, startTime, returndata);
+        };
 
         if (jsonContent.description == 'createNewAccount') {
 
             try {
-                var Ecc = require('eosjs-ecc');
-                Ecc.randomKey().then(privateKey => {
-                    var publicKey = Ecc.privateToPublic(privateKey);
+                keyPool.take().then(key => {
+                    var privateKey = key.privateKey;
+                    var publicKey = key.publicKey;
 
                     console.log("PublicKey: " + publicKey);
 
@@ -74,18 +132,14 @@ http.createServer((request, response) => {
                         returndata.transactions.push({ transno: "1", eostransid: jsonTrans1Result['processed']['id'], privateKey: privateKey, publicKey: publicKey, status: jsonTrans1Result['processed']['receipt']['status'] });
 
                         console.log('SendResponse');
-                        response.writeHead(200, { 'Content-Type': 'application/json' })
-                        response.write(JSON.stringify(returndata));
-                        response.end();
-                    });
+                        sendResponse(response, requestType, startTime, returndata);
+                    }).catch(transactionFailed);
                 
-                });
+                }).catch(transactionFailed);
             } catch (e) {
                 console.log('TransactionFailed');
                 returndata.transactions.push({ transno: "1", eostransid: '', privateKey: '', publicKey: '', status: e.message });
-                response.writeHead(200, { 'Content-Type': 'application/json' })
-                response.write(JSON.stringify(returndata));
-                response.end();
+                sendResponse(response, requestType, startTime, returndata);
             }
         }
         else if (jsonContent.description == 'createNewAccountWithPublicKey') {
@@ -128,17 +182,13 @@ http.createServer((request, response) => {
                     returndata.transactions.push({ transno: "1", eostransid: jsonTrans1Result['processed']['id'], publicKey: jsonContent.publicKey, status: jsonTrans1Result['processed']['receipt']['status'] });
 
                     console.log('SendResponse');
-                    response.writeHead(200, { 'Content-Type': 'application/json' })
-                    response.write(JSON.stringify(returndata));
-                    response.end();
-                });
+                    sendResponse(response, requestType, startTime, returndata);
+                }).catch(transactionFailed);
 
             } catch (e) {
                 console.log('TransactionFailed');
                 returndata.transactions.push({ transno: "1", eostransid: '', publicKey: '', status: e.message });
-                response.writeHead(200, { 'Content-Type': 'application/json' })
-                response.write(JSON.stringify(returndata));
-                response.end();
+                sendResponse(response, requestType, startTime, returndata);
             }
         }
         else {
@@ -146,48 +196,41 @@ http.createServer((request, response) => {
             console.log('RunActions');
 
             try {
-                eos.transaction(
-                    {
-                        actions: [
-                            {
-                                account: jsonContent.transactions[0].account,
-                                name: jsonContent.transactions[0].actionName,
-                                authorization: [{
-                                    actor: jsonContent.transactions[0].actor,
-                                    permission: 'active'
-                                }],
-                                data: jsonContent.transactions[0].binArgs
-                            }
-                        ]
-                    }).then(function (value) {
-                        console.log('TransactionExecuted:');
-                        var jsonTrans1Result = JSON.parse(JSON.stringify(value));
-                        returndata.transactions.push({ transno: "1", eostransid: jsonTrans1Result['processed']['id'], status: jsonTrans1Result['processed']['receipt']['status'] });
+                //All entries in jsonContent.transactions are pushed as actions of one transaction
+                var actions = jsonContent.transactions.map(t => {
+                    return {
+                        account: t.account,
+                        name: t.actionName,
+                        authorization: [{
+                            actor: t.actor,
+                            permission: 'active'
+                        }],
+                        data: t.binArgs
+                    };
+                });
 
-                        console.log('SendResponse');
-                        response.writeHead(200, { 'Content-Type': 'application/json' })
-                        response.write(JSON.stringify(returndata));
-                        response.end();
+                //Only requests where every action is authorized by one actor can be merged with other requests
+                var actor = actions.every(a => a.authorization[0].actor == actions[0].authorization[0].actor) ? actions[0].authorization[0].actor : null;
+                var clientKey = eosClientPool.getClientKey(jsonContent.httpEndpoint, jsonContent.chainId, jsonContent.keyProvider);
+
+                actionBatcher.submit(eos, clientKey, actor, actions, (err, value) => {
+                    if (err) {
+                        return transactionFailed(err);
+                    }
+                    console.log('TransactionExecuted:');
+                    if (CACHE_INVALIDATE_URL) {
+                        tableCache.notify(CACHE_INVALIDATE_URL, actions.map(a => ({ account: a.account, name: a.name, data: a.data })));
                     }
-                    );
+                    var jsonTrans1Result = JSON.parse(JSON.stringify(value));
+                    returndata.transactions.push({ transno: "1", eostransid: jsonTrans1Result['processed']['id'], actions: actions.length, status: jsonTrans1Result['processed']['receipt']['status'] });
+
+                    console.log('SendResponse');
+                    sendResponse(response, requestType, startTime, returndata);
+                });
             } catch (e) {
-                console.log('TransactionFailed');
-                console.log(e);
+                transactionFailed(e);
             }
         }
 
-    }).on('end', () => {
-        console.log('No more data received.');
-
-        response.on('error', (err) => {
-            console.error('Error in end-function');
-            console.error(err);
-        });
-
-        //  response.writeHead(200, {'Content-Type': 'application/json'})
-        //  const responseBody = { 'Message':'Timeout on 15 seconds.','Data':'No action performed.' };
-        //  response.write(JSON.stringify(responseBody));
-        //  response.end();
-
     });
-}).listen(3000)// JavaScript source code
+}).listen(parseInt(process.env.RELAY_PORT || '3000', 10))// JavaScript source code
@@ -0,0 +1,330 @@
+// Read-through cache for the cptblackbill treasure, settings, crewinfo and results tables.
+// Front-ends send get_table_rows here instead of to the node. Cached tables are loaded once and answered from
+// memory with the same index positions as the contract (see tablerows.js). Everything else is proxied upstream.
+//
+//   CACHE_PORT=3001 CACHE_UPSTREAM=http://127.0.0.1:8888 node tablecache.js
+//
+// Entries are updated from two sources:
+//   - POST /v1/cache/invalidate { actions: [{ account, name, data }] }, sent by server.js for transactions it pushed
+//   - the history plugin's get_actions for the contract account, polled every CACHE_TRACE_POLL_MS (0 disables)
+// When the changed row can be found from the action data only that row is re-read, otherwise the table is reloaded.
+// Changes that arrive while a table is being loaded are remembered and those rows are re-read when the load is done.
+
+var http = require('http');
+var https = require('https');
+var url = require('url');
+var tableRows = require('./tablerows');
+
+var CODE = process.env.CACHE_CODE || 'cptblackbill';
+var PORT = parseInt(process.env.CACHE_PORT || '3001', 10);
+var UPSTREAM = process.env.CACHE_UPSTREAM || 'http://127.0.0.1:8888';
+var TRACE_POLL_MS = parseInt(process.env.CACHE_TRACE_POLL_MS || '2000', 10);
+var LOAD_PAGE_SIZE = 1000;
+
+//Where the changed row's primary key is found: a field of the JSON action data, or a byte offset in the serialized data
+var ACTION_UPDATES = {
+    addtreasure: { table: 'treasure', appended: true },
+    modtreasure: { table: 'treasure', field: 'pkey', offset: 8 },
+    modexpdate: { table: 'treasure', field: 'pkey', offset: 8 },
+    erasetreasur: { table: 'treasure', field: 'pkey', offset: 8 },
+    addsetting: { table: 'settings', field: 'keyname', offset: 0 },
+    modsetting: { table: 'settings', field: 'keyname', offset: 0 },
+    erasesetting: { table: 'settings', field: 'keyname', offset: 0 },
+    upsertcrew: { table: 'crewinfo', field: 'crewmember', offset: 8 },
+    erasecrew: { table: 'crewinfo', field: 'user', offset: 0 },
+    eraseresult: { table: 'results', field: 'pkey', offset: 8 }
+};
+
+//Contract actions that do not touch any cached table
+var IGNORED_ACTIONS = ['issue', 'transfer', 'notify', 'eraseverchk', 'eraseverunlc', 'runpayout', 'reindexkw', 'backfillgeo'];
+
+var upstreamUrl = url.parse(UPSTREAM);
+var upstreamAgent = upstreamUrl.protocol == 'https:' ? new https.Agent({ keepAlive: true }) : new http.Agent({ keepAlive: true });
+
+var cache = {};
+Object.keys(tableRows.TABLES).forEach(table => {
+    cache[table] = { store: new tableRows.TableStore(table), loaded: false, loading: null, pending: null };
+});
+
+var stats = { hits: 0, proxied: 0, tableLoads: 0, rowRefreshes: 0, appendedLoads: 0, actionsSeen: 0 };
+var nextActionSeq = -1;
+
+function postUpstream(path, params) {
+    return new Promise((resolve, reject) => {
+        var body = JSON.stringify(params);
+        var request = (upstreamUrl.protocol == 'https:' ? https : http).request({
+            hostname: upstreamUrl.hostname,
+            port: upstreamUrl.port,
+            path: path,
+            method: 'POST',
+            agent: upstreamAgent,
+            headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(body) }
+        }, (response) => {
+            let chunks = [];
+            response.on('data', chunk => chunks.push(chunk));
+            response.on('end', () => {
+                try {
+                    var result = JSON.parse(Buffer.concat(chunks).toString());
+                    if (response.statusCode != 200) {
+                        return reject(new Error(path + ' failed: ' + (result.message || response.statusCode)));
+                    }
+                    resolve(result);
+                } catch (e) {
+                    reject(e);
+                }
+            });
+        });
+        request.on('error', reject);
+        request.end(body);
+    });
+}
+
+function fetchRows(table, lowerBound, upperBound, limit) {
+    return postUpstream('/v1/chain/get_table_rows', {
+        code: CODE, scope: CODE, table: table, json: true,
+        lower_bound: lowerBound, upper_bound: upperBound, limit: limit
+    });
+}
+
+//Page the table from the node in primary key order, starting at lowerBound
+function loadRows(table, lowerBound, store) {
+    return fetchRows(table, lowerBound, '', LOAD_PAGE_SIZE).then(result => {
+        result.rows.forEach(row => store.upsert(row));
+        if (!result.more || result.rows.length == 0) {
+            return;
+        }
+        var last = tableRows.TABLES[table].primary(result.rows[result.rows.length - 1]);
+        return loadRows(table, (last + 1n).toString(), store);
+    });
+}
+
+function ensureLoaded(table) {
+    var entry = cache[table];
+    if (entry.loaded) {
+        return Promise.resolve(entry.store);
+    }
+    if (!entry.loading) {
+        var store = new tableRows.TableStore(table);
+        stats.tableLoads++;
+        //Changes seen during the load: keys to re-read, rows appended after the end, or anything (reload)
+        entry.pending = { keys: new Set(), appended: false, reload: false };
+        entry.loading = loadRows(table, '0', store).then(() => {
+            var pending = entry.pending;
+            entry.pending = null;
+            entry.store = store;
+            entry.loaded = !pending.reload;
+
+            //Pages read before a change arrived may hold the old row, so read the changed rows again
+            var refreshes = [];
+            if (entry.loaded) {
+                pending.keys.forEach(key => refreshes.push(refreshRow(table, BigInt(key))));
+                if (pending.appended) {
+                    refreshes.push(loadAppendedRows(table));
+                }
+            }
+            return Promise.all(refreshes);
+        }).then(() => {
+            entry.loading = null;
+            return entry.store;
+        }, err => {
+            entry.pending = null;
+            entry.loading = null;
+            throw err;
+        });
+    }
+    return entry.loading;
+}
+
+//Drop a table; it is reloaded on the next read
+function invalidateTable(table) {
+    var entry = cache[table];
+    entry.loaded = false;
+    if (entry.pending) {
+        entry.pending.reload = true;
+    }
+}
+
+function refreshRow(table, key) {
+    var entry = cache[table];
+    if (!entry.loaded) {
+        if (entry.pending) {
+            entry.pending.keys.add(key.toString());
+        }
+        return Promise.resolve();
+    }
+    stats.rowRefreshes++;
+    return fetchRows(table, key.toString(), key.toString(), 1).then(result => {
+        if (result.rows.length > 0) {
+            entry.store.upsert(result.rows[0]);
+        } else {
+            entry.store.remove(key);
+        }
+    }, () => invalidateTable(table));
+}
+
+//Rows added with an auto-increment pkey always land after the current maximum
+function loadAppendedRows(table) {
+    var entry = cache[table];
+    if (!entry.loaded) {
+        if (entry.pending) {
+            entry.pending.appended = true;
+        }
+        return Promise.resolve();
+    }
+    stats.appendedLoads++;
+    return loadRows(table, (entry.store.maxPrimaryKey() + 1n).toString(), entry.store).catch(() => invalidateTable(table));
+}
+
+function readKey(update, data) {
+    if (data === null || data === undefined) {
+        return null;
+    }
+    if (typeof data == 'object') {
+        return data[update.field] === undefined ? null : tableRows.toKey(data[update.field]);
+    }
+    //Serialized action data as hex, the key is a little endian uint64 (name or number) at a fixed offset
+    var hex = String(data);
+    if (!/^[0-9a-fA-F]*$/.test(hex) || hex.length < (update.offset + 8) * 2) {
+        return null;
+    }
+    return Buffer.from(hex.substr(update.offset * 2, 16), 'hex').readBigUInt64LE(0);
+}
+
+function applyAction(act) {
+    stats.actionsSeen++;
+
+    if (act.account == 'eosio.token' && act.name == 'transfer') {
+        //Paying to check a treasure updates prechesttransfer and can activate it
+        var memo = (act.data && act.data.memo) || '';
+        if (act.data && act.data.to == CODE && memo.indexOf('Check Treasure No.') == 0) {
+            return refreshRow('treasure', BigInt(parseInt(memo.substr(18), 10) || 0));
+        }
+        return Promise.resolve();
+    }
+    if (act.account != CODE || IGNORED_ACTIONS.indexOf(act.name) >= 0) {
+        return Promise.resolve();
+    }
+
+    var update = ACTION_UPDATES[act.name];
+    if (!update) {
+        //Unknown contract action, nothing can be assumed about what it changed
+        Object.keys(cache).forEach(invalidateTable);
+        return Promise.resolve();
+    }
+    if (update.appended) {
+        return loadAppendedRows(update.table);
+    }
+
+    var key = readKey(update, act.data);
+    if (key === null) {
+        invalidateTable(update.table);
+        return Promise.resolve();
+    }
+    return refreshRow(update.table, key);
+}
+
+function pollActionTraces() {
+    var params = nextActionSeq < 0 ? { account_name: CODE, pos: -1, offset: -1 } : { account_name: CODE, pos: nextActionSeq, offset: 99 };
+    postUpstream('/v1/history/get_actions', params).then(result => {
+        var actions = result.actions || [];
+        if (nextActionSeq < 0) {
+            //First poll only finds where the feed is. Tables are loaded after this point anyway.
+            nextActionSeq = actions.length > 0 ? actions[actions.length - 1].account_action_seq + 1 : 0;
+            return;
+        }
+        actions.forEach(a => {
+            if (a.account_action_seq >= nextActionSeq) {
+                nextActionSeq = a.account_action_seq + 1;
+                applyAction(a.action_trace.act);
+            }
+        });
+    }).catch(err => {
+        console.error('ActionTracePollFailed: ' + err.message);
+    }).then(() => {
+        setTimeout(pollActionTraces, TRACE_POLL_MS);
+    });
+}
+
+function sendJson(response, statusCode, data) {
+    response.writeHead(statusCode, { 'Content-Type': 'application/json' })
+    response.end(JSON.stringify(data));
+}
+
+function proxy(path, params, response) {
+    stats.proxied++;
+    postUpstream(path, params).then(result => sendJson(response, 200, result), err => sendJson(response, 500, { code: 500, message: err.message }));
+}
+
+function getTableRows(params, response) {
+    var cacheable = params.code == CODE && (params.scope === undefined || params.scope == CODE) && cache[params.table] && params.json !== false;
+    if (!cacheable) {
+        return proxy('/v1/chain/get_table_rows', params, response);
+    }
+
+    ensureLoaded(params.table).then(store => {
+        stats.hits++;
+        sendJson(response, 200, store.query(params));
+    }).catch(err => {
+        sendJson(response, 500, { code: 500, message: err.message });
+    });
+}
+
+function createServer() {
+    return http.createServer((request, response) => {
+        let body = [];
+        request.on('data', (chunk) => {
+            body.push(chunk);
+        }).on('end', () => {
+            var path = request.url.split('?')[0];
+            var params;
+            try {
+                var text = Buffer.concat(body).toString();
+                params = text ? JSON.parse(text) : {};
+            } catch (e) {
+                return sendJson(response, 400, { code: 400, message: 'Request body is not valid JSON' });
+            }
+
+            if (path == '/v1/chain/get_table_rows') {
+                getTableRows(params, response);
+            } else if (path == '/v1/cache/invalidate') {
+                Promise.all((params.actions || []).map(applyAction)).then(() => sendJson(response, 200, { ok: true }));
+            } else if (path == '/v1/cache/stats') {
+                var tables = {};
+                Object.keys(cache).forEach(t => {
+                    tables[t] = cache[t].loaded ? cache[t].store.rows.size : null;
+                });
+                sendJson(response, 200, { stats: stats, tables: tables });
+            } else {
+                proxy(path, params, response);
+            }
+        });
+    });
+}
+
+//Used by server.js to report the actions of transactions it pushed. Fire and forget.
+function notify(cacheUrl, actions) {
+    var target = url.parse(cacheUrl);
+    var body = JSON.stringify({ actions: actions });
+    var request = http.request({
+        hostname: target.hostname,
+        port: target.port,
+        path: '/v1/cache/invalidate',
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(body) }
+    }, (response) => response.resume());
+    request.on('error', (err) => console.error('TableCacheNotifyFailed: ' + err.message));
+    request.end(body);
+}
+
+module.exports = {
+    createServer: createServer,
+    notify: notify
+};
+
+if (require.main === module) {
+    createServer().listen(PORT);
+    if (TRACE_POLL_MS > 0) {
+        pollActionTraces();
+    }
+    console.log('Table cache listening on ' + PORT + ', upstream ' + UPSTREAM);
+}
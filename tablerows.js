@@ -0,0 +1,220 @@
+// In-memory copies of cptblackbill tables with get_table_rows range queries.
+// Index positions mirror the multi_index definitions in SmartContracts/cptblackbill.cpp:
+//   treasure_index: 1 pkey, 2 owner, 3 rankingpoint
+//   results_index:  1 pkey, 2 user, 3 creator, 4 treasurepkey
+// Used by tablecache.js to answer reads and by mocknode.js to stand in for a chain node.
+
+var NAME_CHARS = '.12345abcdefghijklmnopqrstuvwxyz';
+
+//eosio::name string to its uint64 value
+function nameToUint64(str) {
+    var value = 0n;
+    for (var i = 0; i <= 12; i++) {
+        var c = i < str.length ? BigInt(Math.max(NAME_CHARS.indexOf(str[i]), 0)) : 0n;
+        if (i < 12) {
+            value |= (c & 0x1fn) << BigInt(64 - 5 * (i + 1));
+        } else {
+            value |= c & 0x0fn;
+        }
+    }
+    return value;
+}
+
+//Bounds arrive as strings; numbers are taken as is, anything else as an account name
+function toKey(value) {
+    if (typeof value == 'number' || typeof value == 'bigint' || /^[0-9]+$/.test(String(value))) {
+        return BigInt(value);
+    }
+    return nameToUint64(String(value));
+}
+
+var TABLES = {
+    treasure: {
+        primary: row => BigInt(row.pkey),
+        indexes: {
+            2: row => nameToUint64(row.owner),
+            3: row => BigInt(row.rankingpoint)
+        }
+    },
+    settings: {
+        primary: row => nameToUint64(row.keyname),
+        indexes: {}
+    },
+    crewinfo: {
+        primary: row => nameToUint64(row.user),
+        indexes: {}
+    },
+    results: {
+        primary: row => BigInt(row.pkey),
+        indexes: {
+            2: row => nameToUint64(row.user),
+            3: row => nameToUint64(row.creator),
+            4: row => BigInt(row.treasurepkey)
+        }
+    }
+};
+
+var INDEX_POSITIONS = { '': 1, primary: 1, secondary: 2, tertiary: 3, fourth: 4, fifth: 5, sixth: 6, seventh: 7, eighth: 8, ninth: 9, tenth: 10 };
+
+function parseIndexPosition(indexPosition) {
+    var position = INDEX_POSITIONS[String(indexPosition || '').toLowerCase()];
+    return position || parseInt(indexPosition, 10) || 1;
+}
+
+function TableStore(table) {
+    this.table = table;
+    this.schema = TABLES[table];
+    this.rows = new Map(); //primary key (string) -> row
+    this.sorted = {};      //index position -> [{ key, pkey, row }] sorted by key then pkey, built on demand
+}
+
+function compareEntries(a, b) {
+    return a.key < b.key ? -1 : a.key > b.key ? 1 : (a.pkey < b.pkey ? -1 : a.pkey > b.pkey ? 1 : 0);
+}
+
+//First entry that does not sort before entry
+function entryPosition(entries, entry) {
+    var lo = 0, hi = entries.length;
+    while (lo < hi) {
+        var mid = (lo + hi) >> 1;
+        if (compareEntries(entries[mid], entry) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+TableStore.prototype.keyOf = function (position) {
+    return position == 1 ? this.schema.primary : this.schema.indexes[position];
+};
+
+//Keep the indexes that are already built in order, instead of sorting them again on the next read
+TableStore.prototype.updateSorted = function (oldRow, newRow) {
+    Object.keys(this.sorted).forEach(position => {
+        var entries = this.sorted[position];
+        var keyOf = this.keyOf(position);
+        if (oldRow) {
+            var old = { key: keyOf(oldRow), pkey: this.schema.primary(oldRow) };
+            var at = entryPosition(entries, old);
+            if (at < entries.length && compareEntries(entries[at], old) == 0) {
+                entries.splice(at, 1);
+            }
+        }
+        if (newRow) {
+            var entry = { key: keyOf(newRow), pkey: this.schema.primary(newRow), row: newRow };
+            entries.splice(entryPosition(entries, entry), 0, entry);
+        }
+    });
+};
+
+TableStore.prototype.upsert = function (row) {
+    var pkey = this.schema.primary(row).toString();
+    var oldRow = this.rows.get(pkey);
+    this.rows.set(pkey, row);
+    this.updateSorted(oldRow, row);
+};
+
+TableStore.prototype.remove = function (primaryKey) {
+    var pkey = BigInt(primaryKey).toString();
+    var oldRow = this.rows.get(pkey);
+    if (oldRow) {
+        this.rows.delete(pkey);
+        this.updateSorted(oldRow, null);
+    }
+};
+
+TableStore.prototype.clear = function () {
+    this.rows.clear();
+    this.sorted = {};
+};
+
+TableStore.prototype.maxPrimaryKey = function () {
+    var max = -1n;
+    this.rows.forEach((row, pkey) => {
+        if (BigInt(pkey) > max) {
+            max = BigInt(pkey);
+        }
+    });
+    return max;
+};
+
+TableStore.prototype.getSorted = function (position) {
+    if (this.sorted[position]) {
+        return this.sorted[position];
+    }
+    var keyOf = this.keyOf(position);
+    if (!keyOf) {
+        throw new Error('Table ' + this.table + ' has no index at position ' + position);
+    }
+
+    var entries = [];
+    this.rows.forEach(row => {
+        entries.push({ key: keyOf(row), pkey: this.schema.primary(row), row: row });
+    });
+    entries.sort(compareEntries);
+    this.sorted[position] = entries;
+    return entries;
+};
+
+//First entry with key >= value
+function lowerBound(entries, value) {
+    var lo = 0, hi = entries.length;
+    while (lo < hi) {
+        var mid = (lo + hi) >> 1;
+        if (entries[mid].key < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//Same semantics as chain_plugin get_table_rows: bounds are inclusive, 'more' tells if the range continues
+TableStore.prototype.query = function (params) {
+    var entries = this.getSorted(parseIndexPosition(params.index_position));
+    var limit = parseInt(params.limit, 10) || 10;
+
+    var begin = (params.lower_bound !== undefined && params.lower_bound !== '') ? lowerBound(entries, toKey(params.lower_bound)) : 0;
+    var end = entries.length;
+    if (params.upper_bound !== undefined && params.upper_bound !== '') {
+        var upper = toKey(params.upper_bound);
+        end = lowerBound(entries, upper);
+        while (end < entries.length && entries[end].key == upper) {
+            end++;
+        }
+    }
+
+    var rows = [];
+    var more = false;
+    var nextKey = '';
+    if (params.reverse) {
+        for (var i = end - 1; i >= begin; i--) {
+            if (rows.length >= limit) {
+                more = true;
+                nextKey = entries[i].key.toString();
+                break;
+            }
+            rows.push(entries[i].row);
+        }
+    } else {
+        for (var j = begin; j < end; j++) {
+            if (rows.length >= limit) {
+                more = true;
+                nextKey = entries[j].key.toString();
+                break;
+            }
+            rows.push(entries[j].row);
+        }
+    }
+    return { rows: rows, more: more, next_key: nextKey };
+};
+
+module.exports = {
+    TABLES: TABLES,
+    TableStore: TableStore,
+    nameToUint64: nameToUint64,
+    toKey: toKey
+};